@@ -3,6 +3,9 @@
 #include <type_traits>
 #include <limits>
 #include <utility>
+#include <cstdint>
+#include <cstring>
+#include "enum.hh"
 
 
 namespace sio {
@@ -58,6 +61,10 @@ public:
         return bitfield { ~bits };
     }
 
+    constexpr integer value() const noexcept {
+        return bits;
+    }
+
     constexpr operator bool() const noexcept {
         return !!bits;
     }
@@ -72,21 +79,88 @@ public:
 };
 
 
+inline unsigned
+highest_bit(std::uintmax_t x) noexcept {
+#ifdef __GNUC__
+    return static_cast<unsigned>(std::numeric_limits<unsigned long long>::digits - 1
+            - __builtin_clzll(x));
+#else
+    unsigned i = 0;
+    while (x >>= 1) ++i;
+    return i;
+#endif
+}
+
+
 template<typename Writer, typename Enum>
 void
-write(Writer &&w, bitfield<Enum> field) {
+write_bitfield(Writer &w, bitfield<Enum> field, bool prefix_once) {
+    using uinteger = std::make_unsigned_t<typename bitfield<Enum>::integer>;
+    auto bits = static_cast<std::uintmax_t>(static_cast<uinteger>(field.value()));
+    if (!bits) return;
+
+    auto &table = enum_table<Enum>::instance();
+    bool parenthesize = prefix_once && (bits & (bits - 1));
+
+    char buf[256];
+    std::size_t pos = 0;
+    auto append = [&](const char *str, std::size_t len) {
+        if (pos + len > sizeof buf) {
+            w.write(buf, pos);
+            pos = 0;
+        }
+        if (len > sizeof buf) {
+            w.write(str, len);
+        } else {
+            std::memcpy(buf + pos, str, len);
+            pos += len;
+        }
+    };
+
+    if (prefix_once) {
+        append(table.prefix(), table.prefix_length());
+        if (parenthesize) append("(", 1);
+    }
     bool first = true;
-    for (int i = std::numeric_limits<typename bitfield<Enum>::integer>::digits-1; i >= 0; --i) {
-        Enum bit = static_cast<Enum>(1 << i);
-        if (field & bit) {
-            if (!first) {
-                write(std::forward<Writer>(w), " | ");
+    while (bits) {
+        auto i = highest_bit(bits);
+        auto bit = std::uintmax_t{1} << i;
+        bits &= ~bit;
+
+        if (!first) {
+            append(" | ", 3);
+        }
+        first = false;
+
+        if (auto entry = table.find(static_cast<Enum>(bit))) {
+            if (prefix_once) {
+                append(entry->name, entry->length);
             } else {
-                first = false;
+                append(entry->qualified_name, entry->qualified_length);
             }
-            write(std::forward<Writer>(w), bit);
+        } else {
+            if (!prefix_once) {
+                append(table.prefix(), table.prefix_length());
+            }
+            char digits[24];
+            char *end = digits + sizeof digits, *d = end;
+            *--d = '>';
+            do {
+                *--d = static_cast<char>('0' + bit % 10);
+            } while (bit /= 10);
+            *--d = '<';
+            append(d, static_cast<std::size_t>(end - d));
         }
     }
+    if (parenthesize) append(")", 1);
+    w.write(buf, pos);
+}
+
+
+template<typename Writer, typename Enum>
+void
+write(Writer &&w, bitfield<Enum> field) {
+    write_bitfield(w, field, false);
 }
 
 
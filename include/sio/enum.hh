@@ -2,13 +2,38 @@
 
 #include <initializer_list>
 #include <utility>
+#include <type_traits>
+#include <algorithm>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstdint>
 
 
 namespace sio {
 
 
 template<typename Enum>
-using enum_name_list = std::pair<const char*, std::initializer_list<std::pair<Enum, const char*>>>;
+class enum_name_list {
+public:
+    using value_type = std::pair<Enum, const char*>;
+
+    enum_name_list(const char *prefix, std::initializer_list<value_type> names)
+        : m_prefix(prefix), m_names(names) {
+    }
+
+    const char *prefix() const noexcept {
+        return m_prefix;
+    }
+
+    const std::vector<value_type> &names() const noexcept {
+        return m_names;
+    }
+
+private:
+    const char *m_prefix;
+    std::vector<value_type> m_names;
+};
 
 template<typename Enum>
 struct enum_names {
@@ -18,4 +43,148 @@ struct enum_names {
 };
 
 
+template<typename Enum>
+class enum_table {
+public:
+    using integer = std::underlying_type_t<Enum>;
+
+    struct entry {
+        Enum value;
+        const char *qualified_name;
+        std::size_t qualified_length;
+        const char *name;
+        std::size_t length;
+    };
+
+    static const enum_table &instance() {
+        static const enum_table table(enum_names<Enum>{}());
+        return table;
+    }
+
+    const char *prefix() const noexcept {
+        return m_strings.data();
+    }
+
+    std::size_t prefix_length() const noexcept {
+        return m_prefix_length;
+    }
+
+    const entry *find(Enum value) const noexcept {
+        if (!m_dense.empty()) {
+            auto index = static_cast<std::uintmax_t>(static_cast<integer>(value))
+                    - static_cast<std::uintmax_t>(m_min);
+            return index < m_dense.size() ? m_dense[index] : nullptr;
+        }
+        auto it = std::lower_bound(m_by_value.begin(), m_by_value.end(), value,
+                [](const entry &e, Enum v) {
+                    return static_cast<integer>(e.value) < static_cast<integer>(v);
+                });
+        return it != m_by_value.end() && it->value == value ? &*it : nullptr;
+    }
+
+    const entry *parse(const char *str, std::size_t length) const noexcept {
+        if (length >= m_prefix_length
+                && std::memcmp(str, prefix(), m_prefix_length) == 0) {
+            str += m_prefix_length;
+            length -= m_prefix_length;
+        }
+        auto less = [](const entry *e, const std::pair<const char*, std::size_t> &s) {
+            auto cmp = std::memcmp(e->name, s.first, std::min(e->length, s.second));
+            return cmp < 0 || (cmp == 0 && e->length < s.second);
+        };
+        auto key = std::make_pair(str, length);
+        auto it = std::lower_bound(m_by_name.begin(), m_by_name.end(), key, less);
+        return it != m_by_name.end() && (*it)->length == length
+                && std::memcmp((*it)->name, str, length) == 0 ? *it : nullptr;
+    }
+
+private:
+    explicit enum_table(const enum_name_list<Enum> &list) {
+        m_prefix_length = std::strlen(list.prefix());
+        std::size_t total = m_prefix_length + 1;
+        for (auto &pair : list.names()) {
+            total += m_prefix_length + std::strlen(pair.second) + 1;
+        }
+
+        m_strings.reserve(total);
+        m_strings.append(list.prefix(), m_prefix_length);
+        m_strings.push_back(0);
+        std::vector<std::size_t> offsets;
+        for (auto &pair : list.names()) {
+            offsets.push_back(m_strings.size());
+            m_strings.append(list.prefix(), m_prefix_length);
+            m_strings.append(pair.second);
+            m_strings.push_back(0);
+        }
+
+        for (std::size_t i = 0; i < offsets.size(); ++i) {
+            auto qualified = m_strings.data() + offsets[i];
+            auto qualified_length = std::strlen(qualified);
+            m_by_value.push_back({ list.names()[i].first, qualified, qualified_length,
+                    qualified + m_prefix_length, qualified_length - m_prefix_length });
+        }
+        std::stable_sort(m_by_value.begin(), m_by_value.end(), [](const entry &a, const entry &b) {
+            return static_cast<integer>(a.value) < static_cast<integer>(b.value);
+        });
+        m_by_value.erase(std::unique(m_by_value.begin(), m_by_value.end(),
+                [](const entry &a, const entry &b) { return a.value == b.value; }),
+                m_by_value.end());
+
+        for (auto &e : m_by_value) {
+            m_by_name.push_back(&e);
+        }
+        std::sort(m_by_name.begin(), m_by_name.end(), [](const entry *a, const entry *b) {
+            auto cmp = std::memcmp(a->name, b->name, std::min(a->length, b->length));
+            return cmp < 0 || (cmp == 0 && a->length < b->length);
+        });
+
+        if (!m_by_value.empty()) {
+            m_min = static_cast<integer>(m_by_value.front().value);
+            auto range = static_cast<std::uintmax_t>(static_cast<integer>(m_by_value.back().value))
+                    - static_cast<std::uintmax_t>(m_min);
+            if (range <= 2 * m_by_value.size() + 8) {
+                m_dense.resize(static_cast<std::size_t>(range) + 1, nullptr);
+                for (auto &e : m_by_value) {
+                    m_dense[static_cast<std::uintmax_t>(static_cast<integer>(e.value))
+                            - static_cast<std::uintmax_t>(m_min)] = &e;
+                }
+            }
+        }
+    }
+
+    std::string m_strings;
+    std::size_t m_prefix_length;
+    std::vector<entry> m_by_value;
+    std::vector<const entry*> m_by_name;
+    std::vector<const entry*> m_dense;
+    integer m_min {};
+};
+
+
+template<typename Enum, std::enable_if_t<std::is_enum<Enum>{}, int> = 0>
+const char *
+enum_name(Enum value) {
+    auto e = enum_table<Enum>::instance().find(value);
+    return e ? e->name : nullptr;
+}
+
+
+template<typename Enum, std::enable_if_t<std::is_enum<Enum>{}, int> = 0>
+bool
+parse_enum(const char *str, std::size_t length, Enum &value) {
+    auto e = enum_table<Enum>::instance().parse(str, length);
+    if (e) {
+        value = e->value;
+    }
+    return e != nullptr;
+}
+
+
+template<typename Enum, std::enable_if_t<std::is_enum<Enum>{}, int> = 0>
+bool
+parse_enum(const std::string &str, Enum &value) {
+    return parse_enum(str.data(), str.length(), value);
+}
+
+
 } // namespace sio
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include "bitfield.hh"
+#include <sio/config.hh>
+
+#ifdef SIO_STATS
+#include <chrono>
+#endif
+
+
+namespace sio {
+
+
+class latency_histogram {
+public:
+    // Bucket i counts durations in [2^i, 2^(i+1)) nanoseconds, bucket 0 also counts 0
+    enum : std::size_t { bucket_count = 48 };
+
+    void record(std::uint64_t ns) noexcept {
+        auto i = std::min<std::size_t>(highest_bit(ns | 1), bucket_count - 1);
+        ++m_buckets[i];
+        ++m_count;
+        m_total += ns;
+        m_max = std::max(m_max, ns);
+    }
+
+    void reset() noexcept {
+        *this = latency_histogram();
+    }
+
+    std::uint64_t count() const noexcept {
+        return m_count;
+    }
+
+    std::uint64_t total_ns() const noexcept {
+        return m_total;
+    }
+
+    std::uint64_t max_ns() const noexcept {
+        return m_max;
+    }
+
+    std::uint64_t bucket(std::size_t i) const noexcept {
+        return m_buckets[i];
+    }
+
+    // Upper bound of the bucket holding the q-quantile, capped at the observed maximum
+    std::uint64_t percentile_ns(double q) const noexcept {
+        if (!m_count) return 0;
+        auto rank = static_cast<std::uint64_t>(q * static_cast<double>(m_count - 1)) + 1;
+        std::uint64_t seen = 0;
+        for (std::size_t i = 0; i < bucket_count; ++i) {
+            seen += m_buckets[i];
+            if (seen >= rank) {
+                return std::min(m_max, (std::uint64_t{2} << i) - 1);
+            }
+        }
+        return m_max;
+    }
+
+private:
+    std::uint64_t m_buckets[bucket_count] = {};
+    std::uint64_t m_count = 0;
+    std::uint64_t m_total = 0;
+    std::uint64_t m_max = 0;
+};
+
+
+struct stream_stats {
+    std::uint64_t bytes_in = 0;
+    std::uint64_t bytes_out = 0;
+    std::uint64_t gets = 0;
+    std::uint64_t puts = 0;
+    std::uint64_t flushes = 0;
+    std::uint64_t seeks = 0;
+    std::uint64_t syscalls = 0;
+    latency_histogram get_latency;
+    latency_histogram put_latency;
+    latency_histogram flush_latency;
+};
+
+
+struct writer_stats {
+    std::uint64_t bytes = 0;
+    std::uint64_t writes = 0;
+    latency_histogram write_latency;
+};
+
+
+#ifdef SIO_STATS
+
+class stats_timer {
+public:
+    explicit stats_timer(latency_histogram &h) noexcept
+        : m_histogram(h), m_start(std::chrono::steady_clock::now()) {
+    }
+
+    ~stats_timer() {
+        auto elapsed = std::chrono::steady_clock::now() - m_start;
+        m_histogram.record(static_cast<std::uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+    }
+
+private:
+    latency_histogram &m_histogram;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+#endif
+
+
+} // namespace sio
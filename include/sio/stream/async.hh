@@ -0,0 +1,311 @@
+#pragma once
+
+#include "stream.hh"
+#include "fd.hh"
+
+#if defined(__cpp_impl_coroutine) && defined(__has_include) && defined(__linux__)
+#if __has_include(<coroutine>)
+#define SIO_ASYNC 1
+#endif
+#endif
+
+#ifdef SIO_ASYNC
+
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+
+
+namespace sio {
+
+
+template<typename T = void>
+class task;
+
+
+namespace detail {
+
+class task_promise_base {
+public:
+    std::suspend_always initial_suspend() noexcept {
+        return {};
+    }
+
+    // Resumes whoever awaited the task, without growing the stack
+    struct final_awaiter {
+        bool await_ready() noexcept { return false; }
+
+        template<typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> h) noexcept {
+            auto next = h.promise().m_continuation;
+            return next ? next : std::noop_coroutine();
+        }
+
+        void await_resume() noexcept {}
+    };
+
+    final_awaiter final_suspend() noexcept {
+        return {};
+    }
+
+    void unhandled_exception() noexcept {
+        m_error = std::current_exception();
+    }
+
+    void set_continuation(std::coroutine_handle<> c) noexcept {
+        m_continuation = c;
+    }
+
+protected:
+    void rethrow() {
+        if (m_error) std::rethrow_exception(m_error);
+    }
+
+private:
+    std::coroutine_handle<> m_continuation;
+    std::exception_ptr m_error;
+};
+
+
+template<typename T>
+class task_promise: public task_promise_base {
+public:
+    task<T> get_return_object() noexcept;
+
+    void return_value(T v) {
+        m_value.emplace(std::move(v));
+    }
+
+    T result() {
+        rethrow();
+        return std::move(*m_value);
+    }
+
+private:
+    std::optional<T> m_value;
+};
+
+
+template<>
+class task_promise<void>: public task_promise_base {
+public:
+    task<void> get_return_object() noexcept;
+
+    void return_void() noexcept {}
+
+    void result() {
+        rethrow();
+    }
+};
+
+} // namespace detail
+
+
+// A lazily started coroutine; awaiting it runs it and yields its result or exception
+template<typename T>
+class task {
+public:
+    using promise_type = detail::task_promise<T>;
+    using handle_type = std::coroutine_handle<promise_type>;
+
+    explicit task(handle_type h) noexcept
+        : m_handle(h) {
+    }
+
+    task(task &&other) noexcept
+        : m_handle(std::exchange(other.m_handle, nullptr)) {
+    }
+
+    task &operator=(task &&other) noexcept {
+        if (this != &other) {
+            if (m_handle) m_handle.destroy();
+            m_handle = std::exchange(other.m_handle, nullptr);
+        }
+        return *this;
+    }
+
+    ~task() {
+        if (m_handle) m_handle.destroy();
+    }
+
+    auto operator co_await() && noexcept {
+        struct awaiter {
+            handle_type h;
+
+            bool await_ready() noexcept { return false; }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> caller) noexcept {
+                h.promise().set_continuation(caller);
+                return h;
+            }
+
+            T await_resume() { return h.promise().result(); }
+        };
+        return awaiter { m_handle };
+    }
+
+private:
+    handle_type m_handle;
+};
+
+
+template<typename T>
+task<T>
+detail::task_promise<T>::get_return_object() noexcept {
+    return task<T>(std::coroutine_handle<task_promise>::from_promise(*this));
+}
+
+inline task<void>
+detail::task_promise<void>::get_return_object() noexcept {
+    return task<void>(std::coroutine_handle<task_promise>::from_promise(*this));
+}
+
+
+// A single-threaded epoll reactor. Run one loop per thread to spread streams over cores
+class event_loop {
+public:
+    event_loop();
+    ~event_loop();
+
+    event_loop(const event_loop &) = delete;
+    event_loop &operator=(const event_loop &) = delete;
+
+    // Starts t on the next run(); the loop owns it until it finishes
+    void spawn(task<void> t);
+
+    // Runs until every spawned task has finished or stop() is called. The first exception that
+    // escapes a spawned task is rethrown once the loop returns
+    void run();
+
+    void stop() noexcept {
+        m_stopped = true;
+    }
+
+    // Suspends until fd is readable or writable, or has hung up or failed. Only one coroutine
+    // may wait for each direction of a descriptor; a second one throws std::logic_error
+    auto readable(int fd) noexcept {
+        return fd_awaiter { *this, fd, false };
+    }
+
+    auto writable(int fd) noexcept {
+        return fd_awaiter { *this, fd, true };
+    }
+
+    // Lets other ready coroutines run first
+    auto yield() noexcept {
+        struct awaiter {
+            event_loop &loop;
+            bool await_ready() noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> h) { loop.m_ready.push_back(h); }
+            void await_resume() noexcept {}
+        };
+        return awaiter { *this };
+    }
+
+    // Drops fd from the reactor; call before closing it. Coroutines still waiting on fd are
+    // resumed on the next turn of the loop
+    void forget(int fd) noexcept;
+
+private:
+    struct fd_awaiter {
+        event_loop &loop;
+        int fd;
+        bool write;
+
+        bool await_ready() noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> h) { loop.watch(fd, write, h); }
+        void await_resume() noexcept {}
+    };
+
+    struct watch_state {
+        std::coroutine_handle<> reader;
+        std::coroutine_handle<> writer;
+        unsigned registered = 0;
+        bool added = false;
+    };
+
+    class detached;
+
+    static detached drive(event_loop &loop, task<void> t);
+
+    void watch(int fd, bool write, std::coroutine_handle<> h);
+    void update(int fd, watch_state &w);
+    void poll();
+
+    int m_epoll;
+    bool m_stopped = false;
+    std::size_t m_live = 0;
+    std::size_t m_waiting = 0;
+    std::deque<std::coroutine_handle<>> m_ready;
+    std::unordered_map<int, watch_state> m_watches;
+    std::exception_ptr m_error;
+};
+
+
+// A pipe, socket or file descriptor driven by an event_loop. Reads and writes go through
+// fd_stream, so both share non-blocking setup and error handling; sockets are written without
+// raising SIGPIPE. Regular files never report EAGAIN, so they are read and written directly
+// without touching the reactor
+class async_fd_stream final: public fd_stream {
+public:
+    // Switches fd to non-blocking mode; closes it on destruction if owned
+    async_fd_stream(event_loop &loop, int fd, bool owned = true);
+    ~async_fd_stream();
+
+    // Completes with at least one byte, or 0 at the end of the stream
+    task<std::size_t> async_get(void *out, std::size_t bytes);
+
+    // Completes once all bytes have been written; a vanished reader fails it with EPIPE
+    task<std::size_t> async_put(const void *in, std::size_t bytes);
+
+    // Nothing is buffered in user space, so this completes immediately
+    task<void> async_flush();
+
+    // Leaves the reactor and closes the descriptor if owned, signalling EOF to a pipe's reader.
+    // A pending async_get or async_put on this stream fails with EBADF
+    virtual void close() noexcept override;
+
+private:
+    event_loop &m_loop;
+};
+
+
+// Blocking sio streams behind the same awaitable interface; each call completes synchronously
+inline task<std::size_t>
+async_get(in_stream &s, void *out, std::size_t bytes) {
+    co_return s.get(out, bytes);
+}
+
+inline task<std::size_t>
+async_put(out_stream &s, const void *in, std::size_t bytes) {
+    co_return s.put(in, bytes);
+}
+
+inline task<void>
+async_flush(out_stream &s) {
+    s.flush();
+    co_return;
+}
+
+inline task<std::size_t>
+async_get(async_fd_stream &s, void *out, std::size_t bytes) {
+    return s.async_get(out, bytes);
+}
+
+inline task<std::size_t>
+async_put(async_fd_stream &s, const void *in, std::size_t bytes) {
+    return s.async_put(in, bytes);
+}
+
+inline task<void>
+async_flush(async_fd_stream &s) {
+    return s.async_flush();
+}
+
+
+} // namespace sio
+
+#endif // SIO_ASYNC
@@ -0,0 +1,225 @@
+#pragma once
+
+#include "stream.hh"
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+
+namespace sio {
+
+
+class decode_error: public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+
+constexpr std::uint64_t
+zigzag_encode(std::int64_t v) noexcept {
+    return (static_cast<std::uint64_t>(v) << 1) ^ static_cast<std::uint64_t>(v >> 63);
+}
+
+
+constexpr std::int64_t
+zigzag_decode(std::uint64_t v) noexcept {
+    return static_cast<std::int64_t>(v >> 1) ^ -static_cast<std::int64_t>(v & 1);
+}
+
+
+namespace detail {
+
+template<std::size_t Size> struct uint_of_size;
+template<> struct uint_of_size<1> { using type = std::uint8_t; };
+template<> struct uint_of_size<2> { using type = std::uint16_t; };
+template<> struct uint_of_size<4> { using type = std::uint32_t; };
+template<> struct uint_of_size<8> { using type = std::uint64_t; };
+
+template<typename T>
+using fixed_bits = typename uint_of_size<sizeof(T)>::type;
+
+template<typename T>
+using is_fixed_encodable = std::integral_constant<bool,
+        (std::is_integral<T>{} || std::is_floating_point<T>{}) && !std::is_same<T, bool>{}
+        && (sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8)>;
+
+// Compilers turn these byte loops into plain or byte-swapped moves
+template<typename T>
+void
+store(char *p, T v, bool big) noexcept {
+    fixed_bits<T> u;
+    std::memcpy(&u, &v, sizeof u);
+    for (std::size_t i = 0; i < sizeof u; ++i) {
+        auto shift = 8 * (big ? sizeof u - 1 - i : i);
+        p[i] = static_cast<char>(static_cast<unsigned char>(u >> shift));
+    }
+}
+
+template<typename T>
+T
+load(const char *p, bool big) noexcept {
+    fixed_bits<T> u = 0;
+    for (std::size_t i = 0; i < sizeof u; ++i) {
+        auto shift = 8 * (big ? sizeof u - 1 - i : i);
+        u = static_cast<fixed_bits<T>>(u
+                | static_cast<fixed_bits<T>>(static_cast<unsigned char>(p[i])) << shift);
+    }
+    T v;
+    std::memcpy(&v, &u, sizeof v);
+    return v;
+}
+
+} // namespace detail
+
+
+// Encodes into a local buffer that reaches the stream on flush; a stream that stops accepting
+// bytes makes the writer throw std::system_error with EPIPE
+class binary_writer {
+public:
+    enum : std::size_t { max_varint = 10 };
+
+    explicit binary_writer(out_stream &out, std::size_t buffer_size = 4096);
+
+    // Flushes; errors from the stream are swallowed, so call flush() first where they matter
+    ~binary_writer();
+
+    binary_writer(const binary_writer &) = delete;
+    binary_writer &operator=(const binary_writer &) = delete;
+
+    template<typename T, std::enable_if_t<detail::is_fixed_encodable<T>{}, int> = 0>
+    void put_le(T v) {
+        detail::store(reserve(sizeof v), v, false);
+        m_size += sizeof v;
+    }
+
+    template<typename T, std::enable_if_t<detail::is_fixed_encodable<T>{}, int> = 0>
+    void put_be(T v) {
+        detail::store(reserve(sizeof v), v, true);
+        m_size += sizeof v;
+    }
+
+    // Unsigned LEB128
+    void put_varint(std::uint64_t v) {
+        char *p = reserve(max_varint), *start = p;
+        while (v >= 0x80) {
+            *p++ = static_cast<char>(v | 0x80);
+            v >>= 7;
+        }
+        *p++ = static_cast<char>(v);
+        m_size += static_cast<std::size_t>(p - start);
+    }
+
+    // Zigzag, then LEB128, so that small negative numbers stay short
+    void put_svarint(std::int64_t v) {
+        put_varint(zigzag_encode(v));
+    }
+
+    void put_bytes(const void *data, std::size_t bytes);
+
+    // Native byte order
+    template<typename T, std::enable_if_t<std::is_trivially_copyable<T>{}, int> = 0>
+    void put_array(const T *data, std::size_t count) {
+        put_bytes(data, count * sizeof(T));
+    }
+
+    // Bytes encoded so far, flushed or not
+    std::uint64_t position() const noexcept {
+        return m_flushed + m_size;
+    }
+
+    void flush();
+
+private:
+    std::size_t put_some(const char *data, std::size_t bytes);
+
+    char *reserve(std::size_t bytes) {
+        if (m_size + bytes > m_buffer.size()) flush();
+        return m_buffer.data() + m_size;
+    }
+
+    out_stream &m_out;
+    std::vector<char> m_buffer;
+    std::size_t m_size = 0;
+    std::uint64_t m_flushed = 0;
+};
+
+
+// Decodes from a local buffer refilled with one get at a time. Reads past the end of the stream
+// and malformed varints throw decode_error
+class binary_reader {
+public:
+    explicit binary_reader(in_stream &in, std::size_t buffer_size = 4096);
+
+    binary_reader(const binary_reader &) = delete;
+    binary_reader &operator=(const binary_reader &) = delete;
+
+    template<typename T, std::enable_if_t<detail::is_fixed_encodable<T>{}, int> = 0>
+    T get_le() {
+        auto v = detail::load<T>(require(sizeof(T)), false);
+        m_pos += sizeof(T);
+        return v;
+    }
+
+    template<typename T, std::enable_if_t<detail::is_fixed_encodable<T>{}, int> = 0>
+    T get_be() {
+        auto v = detail::load<T>(require(sizeof(T)), true);
+        m_pos += sizeof(T);
+        return v;
+    }
+
+    std::uint64_t get_varint() {
+        // Fast path while a whole varint is known to be buffered
+        if (m_end - m_pos >= binary_writer::max_varint) {
+            std::uint64_t v = 0;
+            for (unsigned shift = 0; shift < 64; shift += 7) {
+                auto byte = static_cast<unsigned char>(m_buffer[m_pos++]);
+                // The tenth byte only has room for the top bit
+                if (shift == 63 && byte > 1) break;
+                v |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+                if (!(byte & 0x80)) return v;
+            }
+            throw decode_error("sio::binary_reader: varint overflows 64 bits");
+        }
+        return get_varint_slow();
+    }
+
+    std::int64_t get_svarint() {
+        return zigzag_decode(get_varint());
+    }
+
+    void get_bytes(void *data, std::size_t bytes);
+
+    template<typename T, std::enable_if_t<std::is_trivially_copyable<T>{}, int> = 0>
+    void get_array(T *data, std::size_t count) {
+        get_bytes(data, count * sizeof(T));
+    }
+
+    // True once the buffer is empty and the stream has nothing more
+    bool at_end();
+
+    std::uint64_t position() const noexcept {
+        return m_consumed + m_pos;
+    }
+
+private:
+    const char *require(std::size_t bytes) {
+        if (m_end - m_pos < bytes) refill(bytes);
+        return m_buffer.data() + m_pos;
+    }
+
+    // Keeps the unread bytes and reads until at least bytes are buffered
+    void refill(std::size_t bytes);
+
+    std::uint64_t get_varint_slow();
+
+    in_stream &m_in;
+    std::vector<char> m_buffer;
+    std::size_t m_pos = 0;
+    std::size_t m_end = 0;
+    std::uint64_t m_consumed = 0;
+};
+
+
+} // namespace sio
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "stream.hh"
+#include "file.hh"
+#include <cstdlib>
+#include <memory>
+#include <string>
+
+
+namespace sio {
+
+
+struct direct_options {
+    // Bypass the page cache with O_DIRECT; falls back to buffered writes where the file system
+    // rejects it
+    bool direct = true;
+
+    // Staging buffer size, rounded up to a multiple of the alignment
+    std::size_t buffer_size = 1 << 20;
+
+    // Block size and memory alignment of O_DIRECT transfers
+    std::size_t alignment = 4096;
+
+    // Buffered mode only: start write-back every this many bytes and drop the previous window
+    // from the page cache once it is on disk. 0 leaves write-back to the kernel
+    std::size_t writeback_window = 0;
+};
+
+
+class direct_out_stream final: public out_stream {
+public:
+    explicit direct_out_stream(const std::string &fname, open_mode mode = open_mode::truncate,
+            const direct_options &opts = direct_options());
+
+    ~direct_out_stream();
+
+    direct_out_stream(const direct_out_stream &) = delete;
+    direct_out_stream &operator=(const direct_out_stream &) = delete;
+
+    // Whether writes actually bypass the page cache
+    bool direct() const noexcept {
+        return m_direct;
+    }
+
+    stream_pos size() const noexcept {
+        return m_offset + m_fill;
+    }
+
+    // Writes the unaligned tail, trims block padding and closes the file. Called by the
+    // destructor, which swallows errors
+    void close();
+
+protected:
+    virtual std::size_t v_put(const void *in, std::size_t bytes) override;
+
+    virtual void v_flush() override;
+
+private:
+    struct free_deleter {
+        void operator()(char *p) const noexcept { std::free(p); }
+    };
+
+    void drain(bool tail);
+    void merge_tail_block(std::size_t block_start);
+    void write_at(const char *data, std::size_t bytes, stream_pos offset);
+    void pace();
+
+    int m_fd = -1;
+    bool m_direct = false;
+    std::size_t m_alignment;
+    std::size_t m_capacity;
+    std::size_t m_window;
+    std::unique_ptr<char, free_deleter> m_buffer;
+    std::size_t m_fill = 0;
+
+    // File offset of m_buffer[0]; block aligned in direct mode
+    stream_pos m_offset = 0;
+
+    // Bytes of the file that must survive; padding beyond this is trimmed
+    stream_pos m_file_size = 0;
+    stream_pos m_padded_end = 0;
+
+    stream_pos m_writeback_begin = 0;
+    stream_pos m_writeback_end = 0;
+
+#ifdef SIO_STATS
+    std::uint64_t m_syscalls = 0;
+#endif
+};
+
+
+} // namespace sio
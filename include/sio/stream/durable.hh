@@ -0,0 +1,53 @@
+#pragma once
+
+#include "stream.hh"
+#include "file.hh"
+#include <future>
+#include <memory>
+#include <string>
+
+
+namespace sio {
+
+
+// A file stream that any number of threads may put to and commit concurrently. Commits that
+// arrive while a sync is running are batched into the next fdatasync (group commit). Statistics
+// collected under SIO_STATS are not synchronized
+class durable_out_stream final: public out_stream {
+public:
+    explicit durable_out_stream(const std::string &fname, open_mode mode = open_mode::append,
+            std::size_t buffer_size = 1 << 16);
+
+    // Commits and waits for everything put so far; errors are swallowed, so call sync() first
+    // where they matter
+    ~durable_out_stream();
+
+    durable_out_stream(const durable_out_stream &) = delete;
+    durable_out_stream &operator=(const durable_out_stream &) = delete;
+
+    // Hands buffered data to the kernel and returns a future that becomes ready once everything
+    // put so far, by any thread, is on stable storage. A failed sync fails this and every later
+    // commit, since the kernel may already have dropped the unwritten pages
+    std::future<void> commit();
+
+    void sync() {
+        commit().get();
+    }
+
+    // Number of fdatasync calls made so far; commits per sync is the batching factor
+    std::uint64_t syncs() const;
+
+protected:
+    virtual std::size_t v_put(const void *in, std::size_t bytes) override;
+
+    // Passes buffered data to the kernel without waiting for stable storage
+    virtual void v_flush() override;
+
+private:
+    class syncer;
+
+    std::unique_ptr<syncer> m_syncer;
+};
+
+
+} // namespace sio
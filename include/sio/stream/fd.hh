@@ -0,0 +1,175 @@
+#pragma once
+
+#include "stream.hh"
+#include <memory>
+#include <string>
+#include <vector>
+
+
+namespace sio {
+
+
+enum class io_status {
+    ok,
+    would_block,
+    eof
+};
+
+template<>
+struct enum_names<io_status> {
+    enum_name_list<io_status> operator()() const {
+        return { "sio::io_status::", {
+            { io_status::ok, "ok" }, { io_status::would_block, "would_block" },
+            { io_status::eof, "eof" }
+        } };
+    }
+};
+
+
+struct io_result {
+    std::size_t bytes;
+    io_status status;
+};
+
+
+// Streams over pipes, FIFOs and sockets in non-blocking mode. get() and put() return 0 both
+// when the descriptor would block and at the end of the stream; status() or the try_ variants
+// tell the two apart. A vanished peer reads as eof; sockets are written without raising
+// SIGPIPE, but pipes still raise it unless the signal is ignored
+class fd_stream {
+public:
+    virtual ~fd_stream() = 0;
+
+    fd_stream(const fd_stream&) = delete;
+    fd_stream &operator=(const fd_stream&) = delete;
+
+    int fd() const noexcept {
+        return m_fd;
+    }
+
+    // Outcome of the last get, put or flush
+    io_status status() const noexcept {
+        return m_status;
+    }
+
+    // Blocks until the descriptor is ready or timeout_ms passes (-1 waits forever)
+    bool wait_readable(int timeout_ms = -1) const;
+    bool wait_writable(int timeout_ms = -1) const;
+
+    virtual void close() noexcept;
+
+protected:
+    // Switches fd to non-blocking mode; closes it on destruction if owned
+    explicit fd_stream(int fd, bool owned = true);
+
+    // Opens a FIFO or other special file without blocking on a missing peer. Opening the write
+    // end of a FIFO nobody reads from fails with ENXIO
+    fd_stream(const std::string &path, int flags);
+
+    io_result read_some(void *out, std::size_t bytes);
+    io_result write_some(const void *in, std::size_t bytes);
+
+#ifdef SIO_STATS
+    const std::uint64_t *syscall_counter() const {
+        return &m_syscalls;
+    }
+#endif
+
+    io_status m_status = io_status::ok;
+
+private:
+    int m_fd;
+    bool m_owned;
+    bool m_socket = false;
+#ifdef SIO_STATS
+    std::uint64_t m_syscalls = 0;
+#endif
+};
+
+
+class fd_in_stream: public virtual fd_stream, public virtual in_stream {
+public:
+    explicit fd_in_stream(int fd, bool owned = true)
+        : fd_stream(fd, owned) {
+#ifdef SIO_STATS
+        m_syscall_counter = syscall_counter();
+#endif
+    }
+
+    explicit fd_in_stream(const std::string &path);
+
+    io_result try_get(void *out, std::size_t bytes);
+
+protected:
+    virtual std::size_t v_get(void *out, std::size_t bytes) override;
+};
+
+
+// Whatever the descriptor does not take right away is kept and written by later puts or
+// flushes, up to max_pending bytes; beyond that put accepts less and reports would_block
+class fd_out_stream: public virtual fd_stream, public virtual out_stream {
+public:
+    explicit fd_out_stream(int fd, bool owned = true, std::size_t max_pending = 1 << 20)
+        : fd_stream(fd, owned), m_max_pending(max_pending) {
+#ifdef SIO_STATS
+        m_syscall_counter = syscall_counter();
+#endif
+    }
+
+    explicit fd_out_stream(const std::string &path, std::size_t max_pending = 1 << 20);
+
+    // Writes what it can without blocking; anything the descriptor still refuses is lost, so
+    // flush and wait_writable() first where that matters
+    virtual ~fd_out_stream();
+
+    io_result try_put(const void *in, std::size_t bytes);
+
+    // Writes as much pending data as the descriptor takes; status() is ok once all is out
+    io_status try_flush();
+
+    std::size_t pending() const noexcept {
+        return m_pending.size() - m_pending_begin;
+    }
+
+    // Register for writability (EPOLLOUT) while this is true
+    bool wants_write() const noexcept {
+        return pending() > 0;
+    }
+
+protected:
+    virtual std::size_t v_put(const void *in, std::size_t bytes) override;
+
+    virtual void v_flush() override;
+
+private:
+    std::size_t m_max_pending;
+    std::vector<char> m_pending;
+    std::size_t m_pending_begin = 0;
+};
+
+
+class fd_duplex_stream final: public fd_in_stream, public fd_out_stream,
+        public duplex_stream {
+public:
+    explicit fd_duplex_stream(int fd, bool owned = true, std::size_t max_pending = 1 << 20)
+        : fd_stream(fd, owned), fd_in_stream(fd, owned),
+          fd_out_stream(fd, owned, max_pending) {
+    }
+};
+
+
+struct fd_pipe {
+    fd_in_stream in;
+    fd_out_stream out;
+
+    fd_pipe(int read_end, int write_end)
+        : in(read_end), out(write_end) {
+    }
+};
+
+
+// Both ends non-blocking and close-on-exec
+std::unique_ptr<fd_pipe> make_pipe();
+
+
+} // namespace sio
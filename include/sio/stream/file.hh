@@ -1,13 +1,11 @@
+#pragma once
+
 #include "stream.hh"
+#include <algorithm>
+#include <cstring>
+#include <streambuf>
 #include <string>
-
-
-namespace std {
-
-    template<typename, typename>
-    class basic_streambuf;
-
-}
+#include <vector>
 
 
 namespace sio {
@@ -52,24 +50,67 @@ protected:
     const streambuf_type &streambuf() const { return *m_streambuf; }
     streambuf_type &streambuf() { return *m_streambuf; }
 
+#ifdef SIO_STATS
+    // Only streambufs opened by file_stream itself can observe their system calls
+    const std::uint64_t *syscall_counter() const {
+        return m_owns_streambuf ? &m_syscalls : nullptr;
+    }
+#endif
+
 private:
     std::basic_streambuf<char, std::char_traits<char>> *m_streambuf;
     bool m_owns_streambuf;
+#ifdef SIO_STATS
+    std::uint64_t m_syscalls = 0;
+#endif
 };
 
 
-class file_in_stream: public virtual file_stream, public virtual in_stream {
+// Peeks are served straight from the streambuf's buffer. One that runs past its end is read
+// into a side buffer and the streambuf is sought back, or, where it cannot seek, the side
+// buffer is drained by the following reads
+class file_in_stream: public virtual file_stream, public virtual peek_stream {
 public:
     explicit file_in_stream(streambuf_type &buf)
         : file_stream(buf) {
+#ifdef SIO_STATS
+        m_syscall_counter = syscall_counter();
+#endif
     }
 
     explicit file_in_stream(const std::string &fname)
         : file_stream(fname, allow_get) {
+#ifdef SIO_STATS
+        m_syscall_counter = syscall_counter();
+#endif
+    }
+
+    // Called directly, without going through the virtual bases
+    std::size_t get_inline(void *out, std::size_t bytes) {
+        std::size_t taken = 0;
+        if (m_peeked_pos < m_peeked_end) {
+            taken = std::min(bytes, m_peeked_end - m_peeked_pos);
+            std::memcpy(out, m_peeked.data() + m_peeked_pos, taken);
+            m_peeked_pos += taken;
+            if (taken == bytes) return taken;
+        }
+        return taken + static_cast<std::size_t>(streambuf().sgetn(
+                static_cast<char*>(out) + taken, static_cast<std::streamsize>(bytes - taken)));
     }
 
 protected:
     virtual std::size_t v_get(void *out, std::size_t bytes) final override;
+
+    virtual string_ref v_peek(std::size_t bytes) final override;
+
+    virtual void v_consume(std::size_t bytes) final override;
+
+private:
+    string_ref peek_spanning(std::size_t bytes);
+
+    std::vector<char> m_peeked;
+    std::size_t m_peeked_pos = 0;
+    std::size_t m_peeked_end = 0;
 };
 
 
@@ -77,10 +118,26 @@ class file_out_stream: public virtual file_stream, public virtual out_stream {
 public:
     explicit file_out_stream(streambuf_type &buf)
         : file_stream(buf) {
+#ifdef SIO_STATS
+        m_syscall_counter = syscall_counter();
+#endif
     }
 
     explicit file_out_stream(const std::string &fname, open_mode mode = open_mode::truncate)
         : file_stream(fname, allow_put, mode) {
+#ifdef SIO_STATS
+        m_syscall_counter = syscall_counter();
+#endif
+    }
+
+    // Called directly, without going through the virtual bases
+    std::size_t put_inline(const void *in, std::size_t bytes) {
+        return static_cast<std::size_t>(streambuf().sputn(
+                static_cast<const char*>(in), static_cast<std::streamsize>(bytes)));
+    }
+
+    void flush_inline() {
+        streambuf().pubsync();
     }
 
 protected:
@@ -1,23 +1,27 @@
+#pragma once
+
 #include "stream.hh"
 #include <vector>
 #include <limits>
+#include <algorithm>
 
 
 namespace sio {
 
 
-class memory_stream final: public rw_stream {
-protected:
-    virtual std::size_t v_get(void *out, std::size_t bytes) override {
-        if (m_data.empty()) return 0;
+class memory_stream final: public rw_stream, public peek_stream {
+public:
+    std::size_t get_inline(void *out, std::size_t bytes) {
+        if (m_pos >= m_data.size()) return 0;
 
-        bytes = std::max(bytes, m_data.size() - static_cast<std::size_t>(m_pos));
+        bytes = std::min(bytes, m_data.size() - m_pos);
         auto start = &m_data[0] + m_pos;
         std::copy(start, start + bytes,  static_cast<unsigned char*>(out));
+        m_pos += bytes;
         return bytes;
     }
 
-    virtual std::size_t v_put(const void *in, std::size_t bytes) override {
+    std::size_t put_inline(const void *in, std::size_t bytes) {
         if (static_cast<stream_pos>(m_pos) + bytes > max_pos) {
             bytes = static_cast<std::size_t>(max_pos) - m_pos;
         }
@@ -25,10 +29,31 @@ protected:
             m_data.resize(m_pos + bytes);
         }
         auto byte_in = static_cast<const unsigned char*>(in);
-        std::copy(byte_in, byte_in + bytes, &m_data[0] + m_pos);
+        std::copy(byte_in, byte_in + bytes, m_data.data() + m_pos);
+        m_pos += bytes;
         return bytes;
     }
 
+    void flush_inline() noexcept {}
+
+protected:
+    virtual std::size_t v_get(void *out, std::size_t bytes) override {
+        return get_inline(out, bytes);
+    }
+
+    virtual std::size_t v_put(const void *in, std::size_t bytes) override {
+        return put_inline(in, bytes);
+    }
+
+    virtual string_ref v_peek(std::size_t) override {
+        if (m_pos >= m_data.size()) return {};
+        return { reinterpret_cast<const char*>(m_data.data()) + m_pos, m_data.size() - m_pos };
+    }
+
+    virtual void v_consume(std::size_t bytes) override {
+        if (m_pos < m_data.size()) m_pos += std::min(bytes, m_data.size() - m_pos);
+    }
+
     virtual stream_pos v_seek_get(stream_off offset, sio::seek rel) override {
         return seek_both(offset, rel);
     }
@@ -51,14 +76,15 @@ public:
 
 private:
     stream_pos seek_both(stream_off offset, sio::seek rel) {
-        stream_off new_pos;
+        stream_off new_pos = offset;
         switch (rel) {
-            case sio::seek::set: new_pos = offset; break;
+            case sio::seek::set: break;
             case sio::seek::cur: new_pos = static_cast<stream_off>(m_pos) + offset; break;
-            case sio::seek::end: new_pos = static_cast<stream_off>(m_data.size()) - offset; break;
+            case sio::seek::end: new_pos = static_cast<stream_off>(m_data.size()) + offset; break;
         }
         if (new_pos < 0) new_pos = 0;
-        if (new_pos > static_cast<stream_off>(max_pos)) new_pos = static_cast<stream_off>(max_pos);
+        m_pos = static_cast<stream_pos>(new_pos) > max_pos ? static_cast<std::size_t>(max_pos)
+                : static_cast<std::size_t>(new_pos);
         return m_pos;
     }
 
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "stream.hh"
+#include <vector>
+
+
+namespace sio {
+
+
+// Gives any input stream peek and consume by reading ahead into a buffer of its own, which
+// grows to fit the largest peek
+class peek_in_stream final: public peek_stream {
+public:
+    explicit peek_in_stream(in_stream &in, std::size_t buffer_size = 1 << 16);
+
+    peek_in_stream(const peek_in_stream &) = delete;
+    peek_in_stream &operator=(const peek_in_stream &) = delete;
+
+protected:
+    virtual std::size_t v_get(void *out, std::size_t bytes) override;
+
+    virtual string_ref v_peek(std::size_t bytes) override;
+
+    virtual void v_consume(std::size_t bytes) override;
+
+private:
+    in_stream &m_in;
+    std::vector<char> m_buffer;
+    std::size_t m_pos = 0;
+    std::size_t m_end = 0;
+};
+
+
+} // namespace sio
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "stream.hh"
+#include <memory>
+#include <string>
+
+
+namespace sio {
+
+
+// Reads the next buffer on a helper thread while the caller consumes the current one. Seeks
+// inside the current or prefetched buffer are free; others redirect the prefetch
+class prefetch_read_stream final: public read_stream {
+public:
+    // Wraps a stream that is not used otherwise while the wrapper exists
+    explicit prefetch_read_stream(read_stream &source, std::size_t buffer_size = 1 << 18);
+
+    // Opens fname directly with pread and hints sequential access to the kernel
+    explicit prefetch_read_stream(const std::string &fname, std::size_t buffer_size = 1 << 18);
+
+    ~prefetch_read_stream();
+
+    prefetch_read_stream(const prefetch_read_stream &) = delete;
+    prefetch_read_stream &operator=(const prefetch_read_stream &) = delete;
+
+protected:
+    virtual std::size_t v_get(void *out, std::size_t bytes) override;
+
+    virtual stream_pos v_seek_get(stream_off offset, sio::seek rel) override;
+
+    virtual stream_pos v_tell_get() const override;
+
+private:
+    class prefetcher;
+
+    std::unique_ptr<prefetcher> m_prefetcher;
+};
+
+
+} // namespace sio
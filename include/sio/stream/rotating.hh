@@ -0,0 +1,80 @@
+#pragma once
+
+#include "stream.hh"
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <memory>
+#include <string>
+
+
+namespace sio {
+
+
+struct rotating_options {
+    // Start a new segment before a put would grow the active one past this size; 0 disables
+    std::uint64_t max_bytes = 0;
+
+    // Start a new segment once the active one has been open this long; 0 disables
+    std::chrono::seconds max_age { 0 };
+
+    // Runs on the background thread with the path of each finished segment, e.g. to compress it
+    std::function<void(const std::string &)> archive;
+};
+
+
+// Writes to path and moves finished segments to path.1, path.2, ... A restarted stream appends
+// to path and continues the numbering after the highest existing segment
+class rotating_file_out_stream final: public out_stream {
+public:
+    explicit rotating_file_out_stream(std::string path,
+            rotating_options opts = rotating_options());
+
+    ~rotating_file_out_stream();
+
+    rotating_file_out_stream(const rotating_file_out_stream &) = delete;
+    rotating_file_out_stream &operator=(const rotating_file_out_stream &) = delete;
+
+    const std::string &path() const noexcept {
+        return m_path;
+    }
+
+    // Number the active segment will receive when it is rotated
+    std::uint64_t segment() const noexcept {
+        return m_segment;
+    }
+
+    std::uint64_t size() const noexcept {
+        return m_size;
+    }
+
+    void rotate();
+
+    // Blocks until every finished segment has been closed and archived
+    void wait_idle();
+
+protected:
+    virtual std::size_t v_put(const void *in, std::size_t bytes) override;
+
+    virtual void v_flush() override;
+
+private:
+    using filebuf = std::filebuf;
+    using clock = std::chrono::steady_clock;
+
+    class worker;
+
+    void open();
+
+    std::string m_path;
+    rotating_options m_opts;
+    std::unique_ptr<worker> m_worker;
+    std::unique_ptr<filebuf> m_file;
+    std::uint64_t m_segment = 1;
+    std::uint64_t m_size = 0;
+    clock::time_point m_opened;
+};
+
+
+} // namespace sio
@@ -1,7 +1,13 @@
 #pragma once
 
 #include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
 #include "../enum.hh"
+#include "../string_ref.hh"
+#include "../stats.hh"
 
 
 namespace sio {
@@ -30,6 +36,30 @@ using stream_off = std::make_signed_t<stream_pos>;
 class stream {
 public:
     virtual inline ~stream() = 0;
+
+    // nullptr unless compiled with SIO_STATS
+    const stream_stats *stats() const noexcept {
+#ifdef SIO_STATS
+        m_stats.syscalls = m_syscall_counter ? *m_syscall_counter - m_syscall_base : 0;
+        return &m_stats;
+#else
+        return nullptr;
+#endif
+    }
+
+    void reset_stats() noexcept {
+#ifdef SIO_STATS
+        m_stats = stream_stats();
+        m_syscall_base = m_syscall_counter ? *m_syscall_counter : 0;
+#endif
+    }
+
+#ifdef SIO_STATS
+protected:
+    mutable stream_stats m_stats;
+    const std::uint64_t *m_syscall_counter = nullptr;
+    std::uint64_t m_syscall_base = 0;
+#endif
 };
 
 stream::~stream() {}
@@ -41,7 +71,15 @@ protected:
 
 public:
     std::size_t get(void *out, std::size_t bytes) {
+#ifdef SIO_STATS
+        stats_timer timer(m_stats.get_latency);
+        auto n = v_get(out, bytes);
+        ++m_stats.gets;
+        m_stats.bytes_in += n;
+        return n;
+#else
         return v_get(out, bytes);
+#endif
     }
 };
 
@@ -54,10 +92,22 @@ protected:
 
 public:
     std::size_t put(const void *in, std::size_t bytes) {
+#ifdef SIO_STATS
+        stats_timer timer(m_stats.put_latency);
+        auto n = v_put(in, bytes);
+        ++m_stats.puts;
+        m_stats.bytes_out += n;
+        return n;
+#else
         return v_put(in, bytes);
+#endif
     }
 
     void flush() {
+#ifdef SIO_STATS
+        stats_timer timer(m_stats.flush_latency);
+        ++m_stats.flushes;
+#endif
         v_flush();
     }
 };
@@ -71,18 +121,30 @@ protected:
 
 public:
     stream_pos seek_get(stream_off offset, sio::seek rel) {
+#ifdef SIO_STATS
+        ++m_stats.seeks;
+#endif
         return v_seek_get(offset, rel);
     }
 
     stream_pos seek_get(stream_pos new_pos) {
+#ifdef SIO_STATS
+        ++m_stats.seeks;
+#endif
         return v_seek_get(static_cast<stream_off>(new_pos), sio::seek::set);
     }
 
     stream_pos seek(stream_off offset, sio::seek rel) {
+#ifdef SIO_STATS
+        ++m_stats.seeks;
+#endif
         return v_seek_get(offset, rel);
     }
 
     stream_pos seek(stream_pos new_pos) {
+#ifdef SIO_STATS
+        ++m_stats.seeks;
+#endif
         return v_seek_get(static_cast<stream_off>(new_pos), sio::seek::set);
     }
 
@@ -96,6 +158,31 @@ public:
 };
 
 
+// Input streams that can lend out their buffered bytes instead of copying them
+class peek_stream: public virtual in_stream {
+protected:
+    virtual string_ref v_peek(std::size_t bytes) = 0;
+
+    virtual void v_consume(std::size_t bytes) = 0;
+
+public:
+    // At least bytes bytes, fewer only when the stream has no more. The view may be longer and
+    // stays valid until the next operation on the stream
+    string_ref peek(std::size_t bytes) {
+        return v_peek(bytes);
+    }
+
+    // Skips bytes from the front of the last peek
+    void consume(std::size_t bytes) {
+#ifdef SIO_STATS
+        ++m_stats.gets;
+        m_stats.bytes_in += bytes;
+#endif
+        v_consume(bytes);
+    }
+};
+
+
 class write_stream: public virtual out_stream {
 protected:
     virtual stream_pos v_seek_put(stream_off offset, sio::seek rel) = 0;
@@ -104,18 +191,30 @@ protected:
 
 public:
     stream_pos seek_put(stream_off offset, sio::seek rel) {
+#ifdef SIO_STATS
+        ++m_stats.seeks;
+#endif
         return v_seek_put(offset, rel);
     }
 
     stream_pos seek_put(stream_pos new_pos) {
+#ifdef SIO_STATS
+        ++m_stats.seeks;
+#endif
         return v_seek_put(static_cast<stream_off>(new_pos), sio::seek::set);
     }
 
     stream_pos seek(stream_off offset, sio::seek rel) {
+#ifdef SIO_STATS
+        ++m_stats.seeks;
+#endif
         return v_seek_put(offset, rel);
     }
 
     stream_pos seek(stream_pos new_pos) {
+#ifdef SIO_STATS
+        ++m_stats.seeks;
+#endif
         return v_seek_put(static_cast<stream_off>(new_pos), sio::seek::set);
     }
 
@@ -153,6 +252,132 @@ using is_duplex_stream = std::is_base_of<duplex_stream, std::decay_t<Stream>>;
 template<typename Stream>
 using is_rw_stream = std::is_base_of<rw_stream, std::decay_t<Stream>>;
 
+template<typename Stream>
+using is_peek_stream = std::is_base_of<peek_stream, std::decay_t<Stream>>;
+
+
+class short_read: public std::runtime_error {
+public:
+    short_read(std::size_t bytes, std::size_t expected)
+        : std::runtime_error("sio: stream ended after " + std::to_string(bytes) + " of "
+                + std::to_string(expected) + " bytes"), m_bytes(bytes) {
+    }
+
+    std::size_t bytes() const noexcept {
+        return m_bytes;
+    }
+
+private:
+    std::size_t m_bytes;
+};
+
+
+// Returns false if the stream ends before the first byte and throws short_read if it ends
+// later. A non-blocking stream that has nothing yet counts as ended
+inline bool
+read_exact(in_stream &s, void *out, std::size_t bytes) {
+    auto p = static_cast<char*>(out);
+    std::size_t done = 0;
+    while (done < bytes) {
+        auto n = s.get(p + done, bytes - done);
+        if (n == 0) {
+            if (done == 0) return false;
+            throw short_read(done, bytes);
+        }
+        done += n;
+    }
+    return true;
+}
+
+
+// Concrete streams may additionally expose get_inline, put_inline and flush_inline: the same
+// operations as get, put and flush, but without virtual dispatch through the stream bases.
+// Templates bound to a concrete stream type reach them through static_get, static_put and
+// static_flush, which fall back to the virtual interface for other streams
+namespace detail {
+    // std::void_t is C++17
+    template<typename ...>
+    struct make_void {
+        using type = void;
+    };
+
+    template<typename ...T>
+    using void_t = typename make_void<T...>::type;
+}
+
+template<typename Stream, typename = void>
+struct has_inline_get: std::false_type {};
+
+template<typename Stream>
+struct has_inline_get<Stream, detail::void_t<decltype(std::declval<Stream&>().get_inline(
+        std::declval<void*>(), std::size_t()))>>: std::true_type {};
+
+template<typename Stream, typename = void>
+struct has_inline_put: std::false_type {};
+
+template<typename Stream>
+struct has_inline_put<Stream, detail::void_t<decltype(std::declval<Stream&>().put_inline(
+        std::declval<const void*>(), std::size_t()))>>: std::true_type {};
+
+template<typename Stream, typename = void>
+struct has_inline_flush: std::false_type {};
+
+template<typename Stream>
+struct has_inline_flush<Stream, detail::void_t<decltype(std::declval<Stream&>().flush_inline())>>
+    : std::true_type {};
+
+
+// With SIO_STATS, everything goes through the virtual interface so that statistics stay complete
+template<typename InStream, std::enable_if_t<has_inline_get<InStream>{}, int> = 0>
+std::size_t
+static_get(InStream &s, void *out, std::size_t bytes) {
+#ifdef SIO_STATS
+    return s.get(out, bytes);
+#else
+    return s.get_inline(out, bytes);
+#endif
+}
+
+template<typename InStream, std::enable_if_t<!has_inline_get<InStream>{}, int> = 0>
+std::size_t
+static_get(InStream &s, void *out, std::size_t bytes) {
+    return s.get(out, bytes);
+}
+
+
+template<typename OutStream, std::enable_if_t<has_inline_put<OutStream>{}, int> = 0>
+std::size_t
+static_put(OutStream &s, const void *in, std::size_t bytes) {
+#ifdef SIO_STATS
+    return s.put(in, bytes);
+#else
+    return s.put_inline(in, bytes);
+#endif
+}
+
+template<typename OutStream, std::enable_if_t<!has_inline_put<OutStream>{}, int> = 0>
+std::size_t
+static_put(OutStream &s, const void *in, std::size_t bytes) {
+    return s.put(in, bytes);
+}
+
+
+template<typename OutStream, std::enable_if_t<has_inline_flush<OutStream>{}, int> = 0>
+void
+static_flush(OutStream &s) {
+#ifdef SIO_STATS
+    s.flush();
+#else
+    s.flush_inline();
+#endif
+}
+
+template<typename OutStream, std::enable_if_t<!has_inline_flush<OutStream>{}, int> = 0>
+void
+static_flush(OutStream &s) {
+    s.flush();
+}
+
 
 
 } // namespace sio
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+
+namespace sio {
+
+
+// A borrowed, non-owning range of characters, standing in for std::string_view in C++14
+class string_ref {
+public:
+    constexpr string_ref() noexcept
+        : m_data(nullptr), m_size(0) {
+    }
+
+    constexpr string_ref(const char *data, std::size_t size) noexcept
+        : m_data(data), m_size(size) {
+    }
+
+    string_ref(const char *str) noexcept
+        : m_data(str), m_size(std::strlen(str)) {
+    }
+
+    string_ref(const std::string &str) noexcept
+        : m_data(str.data()), m_size(str.size()) {
+    }
+
+    constexpr const char *data() const noexcept {
+        return m_data;
+    }
+
+    constexpr std::size_t size() const noexcept {
+        return m_size;
+    }
+
+    constexpr bool empty() const noexcept {
+        return m_size == 0;
+    }
+
+    constexpr const char *begin() const noexcept {
+        return m_data;
+    }
+
+    constexpr const char *end() const noexcept {
+        return m_data + m_size;
+    }
+
+    constexpr char operator[](std::size_t i) const noexcept {
+        return m_data[i];
+    }
+
+    // Clamped to the end, unlike std::string_view it never throws
+    constexpr string_ref substr(std::size_t pos, std::size_t count = std::size_t(-1)) const
+            noexcept {
+        return pos >= m_size ? string_ref(m_data + m_size, 0)
+                : string_ref(m_data + pos, count < m_size - pos ? count : m_size - pos);
+    }
+
+    std::string str() const {
+        return std::string(m_data, m_size);
+    }
+
+    friend bool operator==(string_ref lhs, string_ref rhs) noexcept {
+        return lhs.m_size == rhs.m_size
+                && (lhs.m_size == 0 || std::memcmp(lhs.m_data, rhs.m_data, lhs.m_size) == 0);
+    }
+
+    friend bool operator!=(string_ref lhs, string_ref rhs) noexcept {
+        return !(lhs == rhs);
+    }
+
+private:
+    const char *m_data;
+    std::size_t m_size;
+};
+
+
+} // namespace sio
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "writer.hh"
+#include <vector>
+#include <memory>
+
+
+namespace sio {
+
+
+class arena {
+public:
+    explicit arena(std::size_t block_size = 4096);
+
+    arena(const arena &) = delete;
+    arena &operator=(const arena &) = delete;
+
+    char *allocate(std::size_t n);
+
+    char *grow(char *last, std::size_t old_size, std::size_t new_size);
+
+    void reset() noexcept;
+
+    std::size_t capacity() const noexcept;
+
+private:
+    struct block {
+        std::unique_ptr<char[]> data;
+        std::size_t size;
+    };
+
+    void next_block(std::size_t n);
+
+    std::size_t m_block_size;
+    std::vector<block> m_blocks;
+    std::size_t m_current = 0;
+    char *m_pos = nullptr;
+    char *m_end = nullptr;
+};
+
+
+class arena_writer final: public writer {
+public:
+    explicit arena_writer(sio::arena &a) noexcept
+        : m_arena(&a) {
+    }
+
+    string_ref str() const noexcept {
+        return { m_start, m_size };
+    }
+
+    string_ref finish() noexcept {
+        string_ref s = str();
+        m_start = nullptr;
+        m_size = 0;
+        return s;
+    }
+
+protected:
+    virtual void v_write(const char *seq, std::size_t n) override {
+        if (!n) return;
+        m_start = m_arena->grow(m_start, m_size, m_size + n);
+        std::memcpy(m_start + m_size, seq, n);
+        m_size += n;
+    }
+
+private:
+    sio::arena *m_arena;
+    char *m_start = nullptr;
+    std::size_t m_size = 0;
+};
+
+
+template<typename CharSequence, typename ...Params>
+string_ref
+sprintf(arena &a, const CharSequence &fmt, Params &&...args) {
+    arena_writer aw(a);
+    write_formatted(aw, fmt, std::forward_as_tuple(args...));
+    return aw.finish();
+}
+
+
+} // namespace sio
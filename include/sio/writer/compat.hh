@@ -1,5 +1,8 @@
+#pragma once
+
 #include "writer.hh"
-#include <sstream>
+#include <ostream>
+#include <streambuf>
 
 
 namespace sio {
@@ -24,13 +27,57 @@ public:
 };
 
 
+class writeable_streambuf final: public std::streambuf {
+public:
+    writeable_streambuf() noexcept {
+        setp(m_buf, m_buf + sizeof m_buf);
+    }
+
+    void bind(writeable &w) noexcept {
+        m_target = &w;
+        setp(m_buf, m_buf + sizeof m_buf);
+    }
+
+protected:
+    virtual int_type overflow(int_type c) override;
+
+    virtual std::streamsize xsputn(const char *seq, std::streamsize n) override;
+
+    virtual int sync() override;
+
+private:
+    writeable *m_target = nullptr;
+    char m_buf[128];
+};
+
+
+class ostream_bridge {
+public:
+    explicit ostream_bridge(writeable &w);
+    ~ostream_bridge();
+
+    ostream_bridge(const ostream_bridge &) = delete;
+    ostream_bridge &operator=(const ostream_bridge &) = delete;
+
+    std::ostream &stream() noexcept;
+
+    void flush();
+
+private:
+    struct slot;
+
+    slot *m_slot;
+    std::unique_ptr<slot> m_owned;
+};
+
+
 template<typename Writer, typename Value,
         std::enable_if_t<!write_function_defined<Writer, Value>{}
             && ostream_operator_defined<Value>{}, int> = 0>
 void dispatch_write(Writer &w, Value &&v) {
-    std::ostringstream oss;
-    oss << std::forward<Value>(v);
-    write(w, oss.str());
+    ostream_bridge bridge(w);
+    bridge.stream() << std::forward<Value>(v);
+    bridge.flush();
 }
 
 
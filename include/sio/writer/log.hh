@@ -0,0 +1,266 @@
+#pragma once
+
+#include "writer.hh"
+#include "../stream/stream.hh"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+
+
+// Calls below this level compile to nothing and never evaluate their arguments:
+// 0 trace, 1 debug, 2 info, 3 warn, 4 error; 5 removes them all
+#ifndef SIO_LOG_MIN_LEVEL
+#ifdef NDEBUG
+#define SIO_LOG_MIN_LEVEL 2
+#else
+#define SIO_LOG_MIN_LEVEL 0
+#endif
+#endif
+
+// SIO_LOG(info, "message", sio::kv("key", value)...). Arguments are only evaluated once the
+// level has passed both the compile-time and the runtime threshold
+#define SIO_LOG(level, ...) \
+    do { \
+        if (static_cast<int>(::sio::log_level::level) >= SIO_LOG_MIN_LEVEL \
+                && ::sio::log_enabled(::sio::log_level::level)) { \
+            ::sio::log_emit(::sio::log_level::level, __FILE__, __LINE__, __VA_ARGS__); \
+        } \
+    } while (false)
+
+#define SIO_TRACE(...) SIO_LOG(trace, __VA_ARGS__)
+#define SIO_DEBUG(...) SIO_LOG(debug, __VA_ARGS__)
+#define SIO_INFO(...) SIO_LOG(info, __VA_ARGS__)
+#define SIO_WARN(...) SIO_LOG(warn, __VA_ARGS__)
+#define SIO_ERROR(...) SIO_LOG(error, __VA_ARGS__)
+
+
+namespace sio {
+
+
+enum class log_level {
+    trace, debug, info, warn, error, off
+};
+
+template<>
+struct enum_names<log_level> {
+    using e = log_level;
+    enum_name_list<e> operator()() const {
+        return { "sio::log_level::", {
+            { e::trace, "trace" }, { e::debug, "debug" }, { e::info, "info" },
+            { e::warn, "warn" }, { e::error, "error" }, { e::off, "off" }
+        } };
+    }
+};
+
+
+namespace detail {
+    extern std::atomic<int> log_threshold;
+}
+
+inline bool
+log_enabled(log_level level) noexcept {
+    return static_cast<int>(level) >= detail::log_threshold.load(std::memory_order_relaxed);
+}
+
+// Defaults to info
+void set_log_level(log_level level) noexcept;
+
+log_level get_log_level() noexcept;
+
+
+// A field value keeping its type, so that sinks can render numbers, booleans and strings
+// natively. Anything else is referenced and formatted on demand. Values are borrowed and only
+// live as long as the log call
+class log_value {
+public:
+    enum class kind { signed_int, unsigned_int, floating, boolean, string, other };
+
+    template<typename T, std::enable_if_t<std::is_integral<T>{} && std::is_signed<T>{}
+            && !std::is_same<T, char>{}, int> = 0>
+    log_value(T v) noexcept
+        : m_kind(kind::signed_int), m_int(v) {
+    }
+
+    template<typename T, std::enable_if_t<std::is_integral<T>{} && std::is_unsigned<T>{}
+            && !std::is_same<T, bool>{}, int> = 0>
+    log_value(T v) noexcept
+        : m_kind(kind::unsigned_int), m_uint(v) {
+    }
+
+    template<typename T, std::enable_if_t<std::is_floating_point<T>{}, int> = 0>
+    log_value(T v) noexcept
+        : m_kind(kind::floating), m_float(static_cast<double>(v)) {
+    }
+
+    log_value(bool v) noexcept
+        : m_kind(kind::boolean), m_bool(v) {
+    }
+
+    log_value(char c) noexcept
+        : m_kind(kind::string), m_char(c), m_single_char(true) {
+    }
+
+    log_value(const char *s) noexcept
+        : m_kind(kind::string), m_string(s) {
+    }
+
+    log_value(const std::string &s) noexcept
+        : m_kind(kind::string), m_string(s) {
+    }
+
+    log_value(string_ref s) noexcept
+        : m_kind(kind::string), m_string(s) {
+    }
+
+    template<typename T, std::enable_if_t<!std::is_arithmetic<T>{}
+            && !std::is_convertible<const T&, string_ref>{}, int> = 0>
+    log_value(const T &v) noexcept
+        : m_kind(kind::other), m_other { &v, &write_other<T> } {
+    }
+
+    // Fields are copy-initialized from temporaries before C++17. A single char is kept by value,
+    // so that copies do not point into the original
+    log_value(const log_value &) = default;
+    log_value &operator=(const log_value &) = delete;
+
+    kind type() const noexcept { return m_kind; }
+
+    long long as_signed() const noexcept { return m_int; }
+    unsigned long long as_unsigned() const noexcept { return m_uint; }
+    double as_float() const noexcept { return m_float; }
+    bool as_bool() const noexcept { return m_bool; }
+    string_ref as_string() const noexcept {
+        return m_single_char ? string_ref(&m_char, 1) : m_string;
+    }
+
+    // Text form of any kind; floats use the shortest round-trip representation
+    void write(writeable &w) const;
+
+private:
+    template<typename T>
+    static void write_other(writeable &w, const void *v) {
+        w << *static_cast<const T*>(v);
+    }
+
+    struct other_ref {
+        const void *value;
+        void (*write)(writeable &, const void *);
+    };
+
+    kind m_kind;
+    union {
+        long long m_int;
+        unsigned long long m_uint;
+        double m_float;
+        bool m_bool;
+        char m_char;
+        other_ref m_other;
+    };
+    string_ref m_string;
+    bool m_single_char = false;
+};
+
+
+template<typename T>
+struct log_field {
+    const char *key;
+    const T &value;
+};
+
+template<typename T>
+log_field<T>
+kv(const char *key, const T &value) {
+    return { key, value };
+}
+
+
+struct log_field_ref {
+    const char *key;
+    log_value value;
+};
+
+
+struct log_record {
+    log_level level;
+    std::chrono::system_clock::time_point time;
+    const char *file;
+    unsigned line;
+    string_ref message;
+    const log_field_ref *fields;
+    std::size_t field_count;
+};
+
+
+class log_sink {
+public:
+    virtual ~log_sink() {}
+
+    void write(const log_record &r) {
+        v_write(r);
+    }
+
+protected:
+    virtual void v_write(const log_record &r) = 0;
+};
+
+
+// "time level message key=value ...", one line per record with an ISO 8601 UTC time in
+// microseconds unless timestamps is off; warnings and errors flush. Messages and values that
+// are empty or contain spaces, '=', '"' or control characters are double-quoted with C escapes
+class text_log_sink final: public log_sink {
+public:
+    constexpr explicit text_log_sink(out_stream &out, bool timestamps = true)
+        : m_out(out), m_timestamps(timestamps) {
+    }
+
+protected:
+    virtual void v_write(const log_record &r) override;
+
+private:
+    std::mutex m_mutex;
+    out_stream &m_out;
+    bool m_timestamps;
+};
+
+
+// One JSON object per line with time (nanoseconds since the epoch), level, msg, file, line and
+// the fields under their own keys
+class json_log_sink final: public log_sink {
+public:
+    constexpr explicit json_log_sink(out_stream &out)
+        : m_out(out) {
+    }
+
+protected:
+    virtual void v_write(const log_record &r) override;
+
+private:
+    std::mutex m_mutex;
+    out_stream &m_out;
+};
+
+
+// The sink must outlive its use; the default is a text_log_sink on stderr_stream
+void set_log_sink(log_sink &sink) noexcept;
+
+log_sink &get_log_sink() noexcept;
+
+
+namespace detail {
+    void log_dispatch(log_level level, const char *file, unsigned line, string_ref message,
+            const log_field_ref *fields, std::size_t count);
+}
+
+
+template<typename ...Values>
+void
+log_emit(log_level level, const char *file, unsigned line, string_ref message,
+        const log_field<Values> &...fields) {
+    const log_field_ref refs[sizeof...(Values) + 1] = { { fields.key, fields.value }...,
+            { "", false } };
+    detail::log_dispatch(level, file, line, message, refs, sizeof...(Values));
+}
+
+
+} // namespace sio
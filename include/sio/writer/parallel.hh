@@ -0,0 +1,140 @@
+#pragma once
+
+#include "writer.hh"
+#include "../stream/stream.hh"
+#include <deque>
+#include <functional>
+#include <future>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+namespace sio {
+
+
+class task_pool {
+public:
+    // 0 threads uses std::thread::hardware_concurrency()
+    explicit task_pool(std::size_t threads = 0);
+
+    ~task_pool();
+
+    task_pool(const task_pool &) = delete;
+    task_pool &operator=(const task_pool &) = delete;
+
+    std::size_t size() const noexcept;
+
+    void submit(std::function<void()> task);
+
+private:
+    class impl;
+
+    std::unique_ptr<impl> m_impl;
+};
+
+
+struct parallel_options {
+    // Records formatted by one task into one buffer
+    std::size_t chunk_records = 4096;
+
+    // Chunks formatted or waiting to be written at any time, bounding memory use. 0 means twice
+    // the pool size
+    std::size_t max_pending = 0;
+};
+
+
+// Formats [first, last) in chunks on the pool, calling format(writer, record) with a
+// ref_string_writer per chunk, and puts the chunks to out in order. The calling thread writes
+// finished chunks while later ones are still being formatted. The first exception thrown by
+// format is rethrown after in-flight chunks have finished
+template<typename Iterator, typename Format>
+void
+format_parallel(out_stream &out, task_pool &pool, Iterator first, Iterator last,
+        const Format &format, const parallel_options &opts = parallel_options()) {
+    auto chunk_records = std::max<std::size_t>(opts.chunk_records, 1);
+    auto max_pending = opts.max_pending ? opts.max_pending : 2 * pool.size();
+
+    std::deque<std::future<std::string>> pending;
+    std::vector<std::string> free_buffers;
+    std::size_t size_hint = 0;
+
+    auto write_oldest = [&] {
+        auto buf = pending.front().get();
+        pending.pop_front();
+        out.put(buf.data(), buf.size());
+        size_hint = std::max(size_hint, buf.size());
+        buf.clear();
+        free_buffers.push_back(std::move(buf));
+    };
+
+    try {
+        while (first != last) {
+            auto chunk_end = first;
+            for (std::size_t n = 0; n < chunk_records && chunk_end != last; ++n) {
+                ++chunk_end;
+            }
+
+            std::string buf;
+            if (!free_buffers.empty()) {
+                buf = std::move(free_buffers.back());
+                free_buffers.pop_back();
+            }
+            buf.reserve(size_hint);
+
+            auto task = std::make_shared<std::packaged_task<std::string()>>(
+                    [first, chunk_end, &format, buf = std::move(buf)]() mutable {
+                        ref_string_writer w(buf);
+                        for (auto it = first; it != chunk_end; ++it) {
+                            format(w, *it);
+                        }
+                        return std::move(buf);
+                    });
+            pending.push_back(task->get_future());
+            pool.submit([task] { (*task)(); });
+            first = chunk_end;
+
+            if (pending.size() >= max_pending) write_oldest();
+        }
+        while (!pending.empty()) write_oldest();
+    } catch (...) {
+        // Tasks reference format and the range, so they must finish before we unwind
+        for (auto &f : pending) {
+            if (f.valid()) f.wait();
+        }
+        throw;
+    }
+}
+
+
+template<typename Iterator, typename Format>
+void
+format_parallel(out_stream &out, Iterator first, Iterator last, const Format &format,
+        const parallel_options &opts = parallel_options()) {
+    task_pool pool;
+    format_parallel(out, pool, first, last, format, opts);
+}
+
+
+template<typename Range, typename Format>
+void
+format_parallel(out_stream &out, task_pool &pool, const Range &records, const Format &format,
+        const parallel_options &opts = parallel_options()) {
+    using std::begin;
+    using std::end;
+    format_parallel(out, pool, begin(records), end(records), format, opts);
+}
+
+
+template<typename Range, typename Format>
+void
+format_parallel(out_stream &out, const Range &records, const Format &format,
+        const parallel_options &opts = parallel_options()) {
+    using std::begin;
+    using std::end;
+    format_parallel(out, begin(records), end(records), format, opts);
+}
+
+
+} // namespace sio
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "writer.hh"
+#include <vector>
+#include <string>
+
+
+namespace sio {
+
+
+enum class quoting {
+    minimal,
+    all,
+    none
+};
+
+template<>
+struct enum_names<quoting> {
+    enum_name_list<quoting> operator()() const {
+        return { "sio::quoting::", {
+            { quoting::minimal, "minimal" }, { quoting::all, "all" }, { quoting::none, "none" }
+        } };
+    }
+};
+
+
+struct column {
+    bitfield<fmt> flags {};
+    unsigned precision = 6;
+    unsigned width = 0;
+    sio::quoting quoting = sio::quoting::minimal;
+};
+
+
+class table_writer {
+public:
+    table_writer(writeable &w, std::vector<column> columns, char separator = ',',
+            char quote = '"');
+
+    table_writer(const table_writer &) = delete;
+    table_writer &operator=(const table_writer &) = delete;
+
+    template<typename ...Values>
+    void row(const Values &...values) {
+        m_buffer.data.clear();
+        write_fields(0, values...);
+        write(m_buffer, nl);
+        m_target->write(m_buffer.data.data(), m_buffer.data.size());
+    }
+
+    const std::vector<column> &columns() const noexcept {
+        return m_columns;
+    }
+
+private:
+    class row_buffer final: public writer {
+    public:
+        std::string data;
+        const column *col = nullptr;
+        writeable *target = nullptr;
+
+    protected:
+        virtual void v_write(const char *seq, std::size_t n) override {
+            data.append(seq, n);
+        }
+
+        virtual const std::locale &v_locale() const override {
+            return target->locale();
+        }
+
+        virtual sio::line_ending v_line_ending() const noexcept override {
+            return target->line_ending();
+        }
+
+        virtual bitfield<fmt> v_flags() const noexcept override {
+            return col->flags;
+        }
+
+        virtual unsigned v_precision() const noexcept override {
+            return col->precision;
+        }
+    };
+
+    void write_fields(std::size_t) {}
+
+    template<typename Value, typename ...Rest>
+    void write_fields(std::size_t index, const Value &value, const Rest &...rest) {
+        auto start = begin_field(index);
+        dispatch_write(m_buffer, value);
+        end_field(start);
+        write_fields(index + 1, rest...);
+    }
+
+    std::size_t begin_field(std::size_t index);
+    void end_field(std::size_t start);
+
+    writeable *m_target;
+    std::vector<column> m_columns;
+    column m_default_column;
+    char m_separator, m_quote;
+    char m_specials[5];
+    row_buffer m_buffer;
+};
+
+
+} // namespace sio
@@ -0,0 +1,125 @@
+#pragma once
+
+#include "writer.hh"
+#include <chrono>
+#include <climits>
+#include <string>
+#include <vector>
+
+
+namespace sio {
+
+
+enum class time_zone {
+    utc, local
+};
+
+template<>
+struct enum_names<time_zone> {
+    using e = time_zone;
+    enum_name_list<e> operator()() const {
+        return { "sio::time_zone::", {
+            { e::utc, "utc" }, { e::local, "local" }
+        } };
+    }
+};
+
+
+// Formats system_clock time points after a layout of strftime-style fields:
+//   %Y %m %d %H %M %S  year, month, day, hour, minute, second
+//   %a %b              abbreviated English weekday and month names
+//   %z %:z             UTC offset as +hhmm or +hh:mm
+//   %f %1f ... %9f     fraction of the second, 6 digits unless given
+//   %%                 a literal %
+// Everything but the fraction is rendered once per second and reused, so most calls only
+// format the fraction digits. Not thread-safe; keep one per thread or writer
+class time_formatter {
+public:
+    explicit time_formatter(const std::string &layout, time_zone zone = time_zone::utc);
+
+    // ISO 8601 with the given number of fraction digits, ending in Z for UTC
+    static std::string iso8601_layout(unsigned digits = 6, time_zone zone = time_zone::utc);
+
+    template<typename Duration>
+    void write(writeable &w, std::chrono::time_point<std::chrono::system_clock, Duration> tp) {
+        write_ns(w, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                tp.time_since_epoch()).count());
+    }
+
+private:
+    struct field {
+        char spec;
+        bool colon;
+        unsigned digits;
+        std::string literal;
+    };
+
+    struct fraction {
+        std::size_t offset;
+        unsigned digits;
+    };
+
+    void write_ns(writeable &w, long long ns);
+    void refresh(long long second);
+
+    std::vector<field> m_fields;
+    time_zone m_zone;
+    long long m_second = LLONG_MIN;
+    std::string m_cached;
+    std::vector<fraction> m_fractions;
+};
+
+
+namespace detail {
+    // One per thread, layout and zone
+    time_formatter &iso8601_formatter(unsigned digits, time_zone zone);
+
+    void write_duration(writeable &w, long long ns, unsigned precision);
+    void write_iso8601_duration(writeable &w, long long ns);
+}
+
+
+template<typename Duration>
+auto
+timestamp(std::chrono::time_point<std::chrono::system_clock, Duration> tp, unsigned digits = 6,
+        time_zone zone = time_zone::utc) {
+    return make_formatter([=](auto &w) {
+        detail::iso8601_formatter(digits > 9 ? 9 : digits, zone).write(w, tp);
+    });
+}
+
+
+template<typename Duration>
+auto
+timestamp(std::chrono::time_point<std::chrono::system_clock, Duration> tp,
+        time_formatter &layout) {
+    return make_formatter([tp, &layout](auto &w) {
+        layout.write(w, tp);
+    });
+}
+
+
+// In the largest of ns, us, ms and s that keeps the value at or above 1, with up to precision
+// fraction digits and no trailing zeros: 1.5ms, 20us, -3s
+template<typename Rep, typename Period>
+auto
+duration(std::chrono::duration<Rep, Period> d, unsigned precision = 3) {
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+    return make_formatter([=](auto &w) {
+        detail::write_duration(w, ns, precision);
+    });
+}
+
+
+// PT1H2M3.5S
+template<typename Rep, typename Period>
+auto
+iso8601_duration(std::chrono::duration<Rep, Period> d) {
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+    return make_formatter([=](auto &w) {
+        detail::write_iso8601_duration(w, ns);
+    });
+}
+
+
+} // namespace sio
@@ -5,27 +5,17 @@
 #include <memory>
 #include <string>
 #include <cstring>
+#include <algorithm>
 #include "../enum.hh"
 #include "../bitfield.hh"
+#include "../stats.hh"
+#include "../stream/stream.hh"
 
 
 namespace std {
 
-    template<typename Char, typename Traits>
-    class basic_streambuf;
-
-    class ios_base;
     class locale;
 
-    template<typename Char, typename OutputIt>
-    class num_put;
-
-    template<typename Char, typename Traits>
-    class ostreambuf_iterator;
-
-    template<typename Char>
-    struct char_traits;
-
 }
 
 
@@ -103,18 +93,18 @@ struct enum_names<line_ending> {
 class writeable {
 public:
     class ios_cache {
+    public:
+        struct numpunct_data {
+            char decimal_point;
+            char thousands_sep;
+            std::string grouping;
+        };
+
     private:
         struct ref_set {
-            using streambuf_type = std::basic_streambuf<char, std::char_traits<char>>;
-            using num_put_type = std::num_put<char, std::ostreambuf_iterator<char,
-                    std::char_traits<char>>>;
-
-            ~ref_set();
-
-            std::unique_ptr<std::ios_base> ios_base;
-            std::unique_ptr<streambuf_type> streambuf;
             const std::locale *locale;
-            const num_put_type *num_put;
+            numpunct_data numpunct;
+            bool numpunct_valid;
         };
         std::unique_ptr<ref_set> m_refs;
 
@@ -128,32 +118,19 @@ public:
         ref_set &refs(const std::locale &locale) {
             auto &r = refs();
             if (r.locale != &locale) {
-                r.num_put = nullptr;
+                r.numpunct_valid = false;
             }
             r.locale = &locale;
             return r;
         }
 
-        void create_ios_base();
-        void create_streambuf();
-
-        template<typename Facet>
-        static const Facet &cached_facet(Facet *&ptr, const std::locale &locale);
+        void load_numpunct(ref_set &r);
 
     public:
-        template<typename Facet>
-        inline const Facet &locale_facet(const std::locale &);
-
-        std::ios_base &ios_base() {
-            auto &r = refs();
-            if (!r.ios_base) create_ios_base();
-            return *r.ios_base;
-        }
-
-        std::streambuf &streambuf() {
-            auto &r = refs();
-            if (!r.streambuf) create_streambuf();
-            return *r.streambuf;
+        const numpunct_data &numpunct(const std::locale &locale) {
+            auto &r = refs(locale);
+            if (!r.numpunct_valid) load_numpunct(r);
+            return r.numpunct;
         }
     };
 
@@ -196,6 +173,11 @@ public:
     }
 
     void write(const char *seq, std::size_t n) {
+#ifdef SIO_STATS
+        stats_timer timer(m_stats.write_latency);
+        ++m_stats.writes;
+        m_stats.bytes += n;
+#endif
         v_write(seq, n);
     }
 
@@ -210,6 +192,26 @@ public:
     unsigned precision() const noexcept {
         return v_precision();
     }
+
+    // nullptr unless compiled with SIO_STATS
+    const writer_stats *stats() const noexcept {
+#ifdef SIO_STATS
+        return &m_stats;
+#else
+        return nullptr;
+#endif
+    }
+
+    void reset_stats() noexcept {
+#ifdef SIO_STATS
+        m_stats = writer_stats();
+#endif
+    }
+
+#ifdef SIO_STATS
+private:
+    writer_stats m_stats;
+#endif
 };
 
 
@@ -252,10 +254,10 @@ write(Writeable &w, const char (&literal)[N]) {
 }
 
 
-template<typename Writeable, typename ConstIntPtr,
-        std::enable_if_t<std::is_same<const int*, std::remove_reference_t<ConstIntPtr>>{}, int> = 0>
+template<typename Writeable, typename ConstCharPtr,
+        std::enable_if_t<std::is_same<const char*, ConstCharPtr>{}, int> = 0>
 void
-write(Writeable& w, ConstIntPtr string) {
+write(Writeable& w, const ConstCharPtr &string) {
     w.write(string, std::strlen(string));
 }
 
@@ -523,6 +525,58 @@ num(const Number &v, bitfield<fmt> flags, unsigned precision = 6) {
 }
 
 
+enum class float_repr {
+    precision,
+    shortest
+};
+
+template<>
+struct enum_names<float_repr> {
+    enum_name_list<float_repr> operator()() const {
+        return { "sio::float_repr::", {
+            { float_repr::precision, "precision" }, { float_repr::shortest, "shortest" }
+        } };
+    }
+};
+
+
+// Formats all elements into a local batch that reaches w in few large writes. Floats follow
+// flags and precision like single numbers, or use the shortest round-trip form
+template<typename Number, std::enable_if_t<std::is_arithmetic<Number>{}, int> = 0>
+void
+write_array(writeable &w, const Number *data, std::size_t size, const char *separator,
+        bitfield<fmt> flags, unsigned precision, float_repr repr);
+
+
+template<typename Number, std::enable_if_t<std::is_arithmetic<Number>{}, int> = 0>
+auto
+array(const Number *data, std::size_t size, const char *separator = " ",
+        float_repr repr = float_repr::precision) {
+    return make_formatter([=](auto &w) {
+        write_array(w, data, size, separator, w.flags(), w.precision(), repr);
+    });
+}
+
+
+template<typename Container, typename Number = std::remove_cv_t<std::remove_pointer_t<
+        decltype(std::declval<const Container&>().data())>>,
+        std::enable_if_t<std::is_arithmetic<Number>{}, int> = 0>
+auto
+array(const Container &c, const char *separator = " ",
+        float_repr repr = float_repr::precision) {
+    return array(c.data(), c.size(), separator, repr);
+}
+
+
+template<typename Enum>
+auto
+compact(bitfield<Enum> field) {
+    return make_formatter([=](auto &w) {
+        write_bitfield(w, field, true);
+    });
+}
+
+
 class discarding_writer final: public writer {
 protected:
     virtual void v_write(const char *, std::size_t) override {}
@@ -531,6 +585,89 @@ protected:
 extern discarding_writer nirvana;
 
 
+class counting_writer final: public writer {
+public:
+    std::size_t count() const noexcept {
+        return m_count;
+    }
+
+    void reset() noexcept {
+        m_count = 0;
+    }
+
+protected:
+    virtual void v_write(const char *, std::size_t n) override {
+        m_count += n;
+    }
+
+private:
+    std::size_t m_count = 0;
+};
+
+
+class span_writer: public writer {
+public:
+    span_writer(char *buffer, std::size_t capacity) noexcept
+        : m_buffer(buffer), m_capacity(capacity) {
+    }
+
+    const char *data() const noexcept {
+        return m_buffer;
+    }
+
+    std::size_t size() const noexcept {
+        return m_size;
+    }
+
+    std::size_t capacity() const noexcept {
+        return m_capacity;
+    }
+
+    std::size_t required() const noexcept {
+        return m_required;
+    }
+
+    bool truncated() const noexcept {
+        return m_required > m_size;
+    }
+
+    void clear() noexcept {
+        m_size = m_required = 0;
+    }
+
+protected:
+    virtual void v_write(const char *seq, std::size_t n) override {
+        auto copy = std::min(n, m_capacity - m_size);
+        if (copy > 0) {
+            std::memcpy(m_buffer + m_size, seq, copy);
+        }
+        m_size += copy;
+        m_required += n;
+    }
+
+private:
+    char *m_buffer;
+    std::size_t m_capacity;
+    std::size_t m_size = 0;
+    std::size_t m_required = 0;
+};
+
+
+template<std::size_t N>
+class fixed_writer final: public span_writer {
+public:
+    fixed_writer() noexcept
+        : span_writer(m_array, N) {
+    }
+
+    fixed_writer(const fixed_writer &) = delete;
+    fixed_writer &operator=(const fixed_writer &) = delete;
+
+private:
+    char m_array[N];
+};
+
+
 template<typename Ref, typename Store>
 class basic_string_writer final: public writer, public buffered {
 public:
@@ -540,53 +677,42 @@ public:
     template<typename U = Store, std::enable_if_t<!std::is_pointer<U>{}, int> = 0>
     basic_string_writer() {}
 
+    template<typename U = Store, std::enable_if_t<!std::is_pointer<U>{}, int> = 0>
+    explicit basic_string_writer(std::size_t reserve) {
+        m_string.reserve(reserve);
+    }
+
     template<typename U = Store, std::enable_if_t<std::is_pointer<U>{}, int> = 0>
-    explicit basic_string_writer(Ref str)
+    explicit basic_string_writer(Ref str, std::size_t reserve = 0)
         : m_string(&str) {
+        reserve_additional(reserve);
     }
 
     template<typename U = Store, std::enable_if_t<!std::is_pointer<U>{}, int> = 0>
-    explicit basic_string_writer(Ref str)
+    explicit basic_string_writer(Ref str, std::size_t reserve = 0)
         : m_string(std::forward<Ref>(str)) {
+        reserve_additional(reserve);
     }
 
-    basic_string_writer(const basic_string_writer &other) {
-        other.flush();
-        m_string = other.m_string;
-    }
+    basic_string_writer(const basic_string_writer &other) = default;
+    basic_string_writer(basic_string_writer &&other) = default;
 
-    basic_string_writer(basic_string_writer &&other) {
-        other.flush();
-        m_string = std::move(other.m_string);
-    }
+    void flush() const noexcept {}
 
-    ~basic_string_writer() noexcept {
-        try { flush(); } catch(...) {}
-    }
-
-    void flush() const {
-        if (spos) {
-            str_ref().append(scratch, scratch+spos);
-            spos = 0;
+    void reserve_additional(std::size_t additional) {
+        auto &s = str_ref();
+        if (s.size() + additional > s.capacity()) {
+            s.reserve(s.size() + additional);
         }
     }
 
     Ref str() const {
-        flush();
         return static_cast<Ref>(str_ref());
     }
 
 protected:
     virtual void v_write(const char *seq, std::size_t n) override {
-        if (spos + n > sz) {
-            flush();
-        }
-        if (n > sz) {
-            str_ref().append(seq, seq+n);
-        } else {
-            std::copy(seq, seq+n, scratch+spos);
-            spos += n;
-        }
+        str_ref().append(seq, n);
     }
 
 private:
@@ -600,10 +726,7 @@ private:
         return static_cast<std::string&>(m_string);
     }
 
-    static constexpr std::size_t sz = 100;
     mutable Store m_string;
-    char scratch[sz];
-    mutable std::size_t spos = 0;
 };
 
 
@@ -619,6 +742,15 @@ write(Writeable &w, const std::string &str) {
 }
 
 
+// Only exact matches, so that strings and character pointers keep their own overloads
+template<typename Writeable, typename StringRef,
+        std::enable_if_t<std::is_same<string_ref, StringRef>{}, int> = 0>
+void
+write(Writeable &w, const StringRef &str) {
+    w.write(str.data(), str.size());
+}
+
+
 class ret_t {} extern ret;
 
 template<typename Writeable, std::enable_if_t<
@@ -634,19 +766,11 @@ template<typename Writer, typename Enum,
          std::enable_if_t<std::is_enum<Enum>{}, int> = 0>
 void
 write(Writer &w, Enum value) {
-    auto map = enum_names<Enum>{}();
-    write(w, map.first);
-
-    const char *name = nullptr;
-    for (auto &pair : map.second) {
-        if (pair.first == value) {
-            name = pair.second;
-            break;
-        }
-    }
-    if (name) {
-        write(w, name);
+    auto &table = enum_table<Enum>::instance();
+    if (auto entry = table.find(value)) {
+        w.write(entry->qualified_name, entry->qualified_length);
     } else {
+        w.write(table.prefix(), table.prefix_length());
         write(w, "<");
         write(w, static_cast<std::underlying_type_t<Enum>>(value));
         write(w, ">");
@@ -654,6 +778,38 @@ write(Writer &w, Enum value) {
 }
 
 
+template<typename Writeable>
+void
+write(Writeable &w, const latency_histogram &h) {
+    w << "n=" << h.count();
+    if (h.count()) {
+        w << " mean=" << h.total_ns() / h.count() << "ns p50<=" << h.percentile_ns(.5)
+          << "ns p90<=" << h.percentile_ns(.9) << "ns p99<=" << h.percentile_ns(.99)
+          << "ns max=" << h.max_ns() << "ns";
+    }
+}
+
+
+template<typename Writeable>
+void
+write(Writeable &w, const stream_stats &s) {
+    w << "bytes in " << s.bytes_in << ", out " << s.bytes_out << "; calls get " << s.gets
+      << ", put " << s.puts << ", flush " << s.flushes << ", seek " << s.seeks
+      << "; syscalls " << s.syscalls << nl
+      << "get latency: " << s.get_latency << nl
+      << "put latency: " << s.put_latency << nl
+      << "flush latency: " << s.flush_latency << nl;
+}
+
+
+template<typename Writeable>
+void
+write(Writeable &w, const writer_stats &s) {
+    w << "bytes " << s.bytes << ", writes " << s.writes << nl
+      << "write latency: " << s.write_latency << nl;
+}
+
+
 template<typename OutStream>
 class stream_writer final: public writer {
 public:
@@ -662,8 +818,10 @@ public:
     }
 
 protected:
+    // Binds to OutStream's inline put where it has one, so a concrete stream type avoids the
+    // virtual stream interface entirely
     virtual void v_write(const char *seq, std::size_t n) override {
-        m_stream->put(seq, n);
+        static_put(*m_stream, seq, n);
     }
 
 private:
@@ -691,7 +849,7 @@ void dispatch_write_tuple_element(Writeable &w, const Tuple &, std::size_t) {
 
 template<typename CharSequence, typename Writer, typename ArgTuple>
 void
-write_formatted(Writer &w, const CharSequence &fmt_str, const ArgTuple args) {
+write_formatted(Writer &w, const CharSequence &fmt_str, const ArgTuple &args) {
     class mutator final: public format_mod<Writer> {
     public:
         bitfield<fmt> new_flags {}, flag_mask {};
@@ -790,6 +948,15 @@ write_formatted(Writer &w, const CharSequence &fmt_str, const ArgTuple args) {
 }
 
 
+template<typename CharSequence, typename ...Params>
+std::size_t
+formatted_size(const CharSequence &fmt, const Params &...args) {
+    counting_writer cw;
+    write_formatted(cw, fmt, std::forward_as_tuple(args...));
+    return cw.count();
+}
+
+
 template<typename ...Params>
 auto
 format(const std::string &fmt, const Params &...arg_list) {
@@ -803,9 +970,39 @@ format(const std::string &fmt, const Params &...arg_list) {
 template<typename CharSequence, typename ...Params>
 std::string
 sprintf(const CharSequence fmt, Params &&...args) {
-    string_writer sw;
-    write_formatted(sw, fmt, std::make_tuple(args...));
-    return sw.str();
+    std::string str;
+    ref_string_writer sw(str);
+    write_formatted(sw, fmt, std::forward_as_tuple(args...));
+    return str;
+}
+
+
+// sprintf with a formatted_size() dry run first, so that the result is allocated exactly once.
+// Every value is formatted twice; only worth it for long results of cheap arguments
+template<typename CharSequence, typename ...Params>
+std::string
+sprintf_exact(const CharSequence fmt, Params &&...args) {
+    auto arg_tuple = std::forward_as_tuple(args...);
+    counting_writer cw;
+    write_formatted(cw, fmt, arg_tuple);
+
+    std::string str;
+    ref_string_writer sw(str, cw.count());
+    write_formatted(sw, fmt, arg_tuple);
+    return str;
+}
+
+
+// Formats into a caller-supplied buffer with std::snprintf semantics: writes at most size - 1
+// characters and a terminating NUL if size is not zero, and returns the length the complete
+// output would have had
+template<typename CharSequence, typename ...Params>
+std::size_t
+format_to(char *buffer, std::size_t size, const CharSequence &fmt, Params &&...args) {
+    span_writer sw(buffer, size > 0 ? size - 1 : 0);
+    write_formatted(sw, fmt, std::forward_as_tuple(args...));
+    if (size > 0) buffer[sw.size()] = 0;
+    return sw.required();
 }
 
 
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <sio/writer/stdio.hh>
+#include <sio/writer/table.hh>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+
+namespace bench {
+
+
+// Keeps results observable so that the compiler cannot drop the benchmarked work
+extern volatile std::size_t sink;
+
+// Spelled out because compound assignment to a volatile is deprecated in C++20
+inline void
+consume(std::size_t v) {
+    sink = sink + v;
+}
+
+
+struct options {
+    unsigned long warmup = 2;
+    unsigned long reps = 7;
+    unsigned long iters = 100000;
+    std::string filter;
+    bool json = false;
+
+    // extra(arg, next) handles program-specific arguments and returns whether it knew arg
+    template<typename Extra>
+    options(int argc, char **argv, const char *extra_usage, Extra &&extra) {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            auto next = [&] { return std::string(i + 1 < argc ? argv[++i] : ""); };
+            if (arg == "--warmup") {
+                warmup = std::strtoul(next().c_str(), nullptr, 10);
+            } else if (arg == "--reps") {
+                reps = std::max(1ul, std::strtoul(next().c_str(), nullptr, 10));
+            } else if (arg == "--iters") {
+                iters = std::max(1ul, std::strtoul(next().c_str(), nullptr, 10));
+            } else if (arg == "--filter") {
+                filter = next();
+            } else if (arg == "--json") {
+                json = true;
+            } else if (arg == "--csv") {
+                json = false;
+            } else if (!extra(arg, next)) {
+                sio::err_printf("usage: {} [--warmup N] [--reps N] [--iters N] [--filter S] "
+                        "[--csv|--json]{}\n", argv[0], extra_usage);
+                std::exit(1);
+            }
+        }
+    }
+
+    options(int argc, char **argv)
+        : options(argc, argv, "", [](const std::string &, auto &) { return false; }) {
+    }
+
+    bool selected(const std::string &name) const {
+        return filter.empty() || name.find(filter) != std::string::npos;
+    }
+};
+
+
+class report {
+public:
+    report(bool json, std::vector<const char*> columns)
+        : m_json(json), m_columns(std::move(columns)),
+          m_table(sio::out, std::vector<sio::column>(m_columns.size())) {
+        if (m_json) {
+            sio::out << "[";
+        } else {
+            for (std::size_t i = 0; i < m_columns.size(); ++i) {
+                sio::out << (i ? "," : "") << m_columns[i];
+            }
+            sio::out << sio::nl;
+        }
+    }
+
+    report(const report &) = delete;
+    report &operator=(const report &) = delete;
+
+    ~report() {
+        if (m_json) {
+            sio::out << sio::nl << "]" << sio::nl;
+        }
+    }
+
+    template<typename ...Values>
+    void row(const Values &...values) {
+        if (m_json) {
+            sio::out << (m_first ? "" : ",") << sio::nl << "  {";
+            json_fields(0, values...);
+            sio::out << "}";
+        } else {
+            m_table.row(values...);
+        }
+        m_first = false;
+    }
+
+private:
+    void json_fields(std::size_t) {}
+
+    template<typename Value, typename ...Rest>
+    void json_fields(std::size_t i, const Value &value, const Rest &...rest) {
+        sio::out << (i ? ", " : "") << "\"" << m_columns[i] << "\": ";
+        json_value(value);
+        json_fields(i + 1, rest...);
+    }
+
+    template<typename Number, std::enable_if_t<std::is_arithmetic<Number>{}, int> = 0>
+    void json_value(const Number &v) {
+        sio::out << v;
+    }
+
+    void json_value(const std::string &v) {
+        sio::out << "\"" << v << "\"";
+    }
+
+    void json_value(const char *v) {
+        sio::out << "\"" << v << "\"";
+    }
+
+    bool m_json;
+    bool m_first = true;
+    std::vector<const char*> m_columns;
+    sio::table_writer m_table;
+};
+
+
+class runner {
+public:
+    runner(int argc, char **argv)
+        : m_opts(argc, argv), m_report(m_opts.json, { "group", "name", "param", "iterations",
+            "repetitions", "min_ns", "median_ns", "mean_ns", "max_ns" }) {
+    }
+
+    unsigned long iterations() const noexcept {
+        return m_opts.iters;
+    }
+
+    // fn(iterations) performs that many operations; reported times are per operation
+    template<typename Fn>
+    void run(const char *group, const char *name, const std::string &param, Fn &&fn) {
+        if (!m_opts.selected(std::string(group) + "/" + name + "/" + param)) return;
+
+        for (unsigned long i = 0; i < m_opts.warmup; ++i) {
+            fn(m_opts.iters);
+        }
+        std::vector<double> ns;
+        for (unsigned long i = 0; i < m_opts.reps; ++i) {
+            auto start = clock::now();
+            fn(m_opts.iters);
+            auto elapsed = std::chrono::duration<double, std::nano>(clock::now() - start);
+            ns.push_back(elapsed.count() / static_cast<double>(m_opts.iters));
+        }
+
+        std::sort(ns.begin(), ns.end());
+        double sum = 0;
+        for (auto v : ns) sum += v;
+        double median = ns.size() % 2 ? ns[ns.size() / 2]
+                : (ns[ns.size() / 2 - 1] + ns[ns.size() / 2]) / 2;
+        m_report.row(group, name, param, m_opts.iters, m_opts.reps, ns.front(), median,
+                sum / static_cast<double>(ns.size()), ns.back());
+    }
+
+private:
+    using clock = std::chrono::steady_clock;
+
+    options m_opts;
+    report m_report;
+};
+
+
+} // namespace bench
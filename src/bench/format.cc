@@ -0,0 +1,398 @@
+#include "bench.hh"
+#include <sio/stream/memory.hh>
+#include <sio/writer/log.hh>
+#include <sio/writer/time.hh>
+#include <sio/writer/writer.hh>
+#include <cstdio>
+#include <ctime>
+#include <sstream>
+#include <string>
+#include <vector>
+#if __cplusplus >= 201703L && __has_include(<charconv>)
+#include <charconv>
+#endif
+
+
+volatile std::size_t bench::sink;
+
+
+namespace {
+
+struct int_case {
+    const char *param;
+    sio::bitfield<sio::fmt> flags;
+    std::ios_base::fmtflags iosflags;
+    const char *printf_format;
+    int base;
+};
+
+const int_case int_cases[] = {
+    { "dec", {}, std::ios_base::dec, "%llu", 10 },
+    { "hex", sio::fmt::hex, std::ios_base::hex, "%llx", 16 },
+    { "oct", sio::fmt::oct, std::ios_base::oct, "%llo", 8 },
+    { "hex_base_upper", sio::fmt::hex | sio::fmt::show_base | sio::fmt::uppercase,
+        std::ios_base::hex | std::ios_base::showbase | std::ios_base::uppercase, "%#llX", 0 },
+};
+
+
+struct float_case {
+    const char *param;
+    sio::bitfield<sio::fmt> flags;
+    std::ios_base::fmtflags iosflags;
+    const char *printf_format;
+};
+
+const float_case float_cases[] = {
+    { "general", {}, {}, "%g" },
+    { "fixed", sio::fmt::fixed, std::ios_base::fixed, "%f" },
+    { "sci", sio::fmt::sci, std::ios_base::scientific, "%e" },
+    { "sci_upper_sign", sio::fmt::sci | sio::fmt::uppercase | sio::fmt::show_sign,
+        std::ios_base::scientific | std::ios_base::uppercase | std::ios_base::showpos, "%+E" },
+};
+
+
+unsigned long long
+int_value(unsigned long i) {
+    return (i * 2654435761ull) >> (i % 48);
+}
+
+
+double
+float_value(unsigned long i) {
+    return static_cast<double>(i) * 1.2345e-3 + 0.5;
+}
+
+
+void
+bench_integers(bench::runner &r) {
+    for (auto &c : int_cases) {
+        r.run("int", "sio", c.param, [&](unsigned long n) {
+            sio::fixed_writer<64> fw;
+            for (unsigned long i = 0; i < n; ++i) {
+                fw.clear();
+                fw << sio::num(int_value(i), c.flags);
+                bench::consume(fw.size());
+            }
+        });
+        r.run("int", "sio_string", c.param, [&](unsigned long n) {
+            std::string str;
+            sio::ref_string_writer sw(str);
+            for (unsigned long i = 0; i < n; ++i) {
+                str.clear();
+                sw << sio::num(int_value(i), c.flags);
+                bench::consume(str.size());
+            }
+        });
+        r.run("int", "ostringstream", c.param, [&](unsigned long n) {
+            std::ostringstream oss;
+            oss.flags(c.iosflags);
+            for (unsigned long i = 0; i < n; ++i) {
+                oss.str(std::string());
+                oss << int_value(i);
+                bench::consume(static_cast<std::size_t>(oss.tellp()));
+            }
+        });
+        r.run("int", "snprintf", c.param, [&](unsigned long n) {
+            char buf[64];
+            for (unsigned long i = 0; i < n; ++i) {
+                bench::consume(static_cast<std::size_t>(
+                        std::snprintf(buf, sizeof buf, c.printf_format, int_value(i))));
+            }
+        });
+#if __cplusplus >= 201703L && __has_include(<charconv>)
+        if (c.base) {
+            r.run("int", "to_chars", c.param, [&](unsigned long n) {
+                char buf[64];
+                for (unsigned long i = 0; i < n; ++i) {
+                    auto res = std::to_chars(buf, buf + sizeof buf, int_value(i), c.base);
+                    bench::consume(static_cast<std::size_t>(res.ptr - buf));
+                }
+            });
+        }
+#endif
+    }
+}
+
+
+void
+bench_floats(bench::runner &r) {
+    for (auto &c : float_cases) {
+        r.run("float", "sio", c.param, [&](unsigned long n) {
+            sio::fixed_writer<64> fw;
+            for (unsigned long i = 0; i < n; ++i) {
+                fw.clear();
+                fw << sio::num(float_value(i), c.flags);
+                bench::consume(fw.size());
+            }
+        });
+        r.run("float", "ostringstream", c.param, [&](unsigned long n) {
+            std::ostringstream oss;
+            oss.flags(c.iosflags);
+            for (unsigned long i = 0; i < n; ++i) {
+                oss.str(std::string());
+                oss << float_value(i);
+                bench::consume(static_cast<std::size_t>(oss.tellp()));
+            }
+        });
+        r.run("float", "snprintf", c.param, [&](unsigned long n) {
+            char buf[64];
+            for (unsigned long i = 0; i < n; ++i) {
+                bench::consume(static_cast<std::size_t>(
+                        std::snprintf(buf, sizeof buf, c.printf_format, float_value(i))));
+            }
+        });
+#if __cplusplus >= 201703L && __has_include(<charconv>) && defined(__cpp_lib_to_chars)
+        r.run("float", "to_chars", c.param, [&](unsigned long n) {
+            auto fmt = c.flags & sio::fmt::fixed ? std::chars_format::fixed
+                    : c.flags & sio::fmt::sci ? std::chars_format::scientific
+                    : std::chars_format::general;
+            char buf[64];
+            for (unsigned long i = 0; i < n; ++i) {
+                auto res = std::to_chars(buf, buf + sizeof buf, float_value(i), fmt, 6);
+                bench::consume(static_cast<std::size_t>(res.ptr - buf));
+            }
+        });
+#endif
+    }
+}
+
+
+void
+bench_strings(bench::runner &r) {
+    const std::string value = "a string of moderate length, 48 bytes in total.";
+    r.run("string", "sio", "48", [&](unsigned long n) {
+        sio::fixed_writer<64> fw;
+        for (unsigned long i = 0; i < n; ++i) {
+            fw.clear();
+            fw << value;
+            bench::consume(fw.size());
+        }
+    });
+    r.run("string", "ostringstream", "48", [&](unsigned long n) {
+        std::ostringstream oss;
+        for (unsigned long i = 0; i < n; ++i) {
+            oss.str(std::string());
+            oss << value;
+            bench::consume(static_cast<std::size_t>(oss.tellp()));
+        }
+    });
+    r.run("string", "snprintf", "48", [&](unsigned long n) {
+        char buf[64];
+        for (unsigned long i = 0; i < n; ++i) {
+            bench::consume(static_cast<std::size_t>(
+                    std::snprintf(buf, sizeof buf, "%s", value.c_str())));
+        }
+    });
+}
+
+
+void
+bench_enums(bench::runner &r) {
+    const sio::line_ending values[] = { sio::line_ending::cr, sio::line_ending::lf,
+        sio::line_ending::crlf };
+    r.run("enum", "sio", "line_ending", [&](unsigned long n) {
+        sio::fixed_writer<64> fw;
+        for (unsigned long i = 0; i < n; ++i) {
+            fw.clear();
+            fw << values[i % 3];
+            bench::consume(fw.size());
+        }
+    });
+
+    const sio::bitfield<sio::fmt> fields[] = { sio::fmt::hex,
+        sio::fmt::hex | sio::fmt::show_base | sio::fmt::uppercase,
+        sio::fmt::fixed | sio::fmt::left | sio::fmt::show_point | sio::fmt::show_sign };
+    r.run("bitfield", "sio", "prefix_each", [&](unsigned long n) {
+        sio::fixed_writer<256> fw;
+        for (unsigned long i = 0; i < n; ++i) {
+            fw.clear();
+            fw << fields[i % 3];
+            bench::consume(fw.size());
+        }
+    });
+    r.run("bitfield", "sio", "prefix_once", [&](unsigned long n) {
+        sio::fixed_writer<256> fw;
+        for (unsigned long i = 0; i < n; ++i) {
+            fw.clear();
+            fw << sio::compact(fields[i % 3]);
+            bench::consume(fw.size());
+        }
+    });
+}
+
+
+void
+bench_formatted(bench::runner &r) {
+    r.run("formatted", "sio", "positional", [&](unsigned long n) {
+        char buf[128];
+        for (unsigned long i = 0; i < n; ++i) {
+            bench::consume(sio::format_to(buf, sizeof buf, "id={1} name={0} hex={2x} val={3f}",
+                    "record", i, int_value(i), float_value(i)));
+        }
+    });
+    r.run("formatted", "ostringstream", "positional", [&](unsigned long n) {
+        std::ostringstream oss;
+        for (unsigned long i = 0; i < n; ++i) {
+            oss.str(std::string());
+            oss << "id=" << i << " name=" << "record" << " hex=" << std::hex << int_value(i)
+                << std::dec << " val=" << std::fixed << float_value(i) << std::defaultfloat;
+            bench::consume(static_cast<std::size_t>(oss.tellp()));
+        }
+    });
+    r.run("formatted", "snprintf", "positional", [&](unsigned long n) {
+        char buf[128];
+        for (unsigned long i = 0; i < n; ++i) {
+            bench::consume(static_cast<std::size_t>(std::snprintf(buf, sizeof buf,
+                    "id=%lu name=%s hex=%llx val=%f", i, "record", int_value(i),
+                    float_value(i))));
+        }
+    });
+
+    r.run("format_mods", "sio", "chained", [&](unsigned long n) {
+        sio::fixed_writer<128> fw;
+        for (unsigned long i = 0; i < n; ++i) {
+            fw.clear();
+            fw << sio::hex << sio::show_base << int_value(i) << " " << sio::oct << i << " "
+               << sio::sci << sio::uppercase << float_value(i);
+            bench::consume(fw.size());
+        }
+    });
+    r.run("format_mods", "ostringstream", "chained", [&](unsigned long n) {
+        std::ostringstream oss;
+        for (unsigned long i = 0; i < n; ++i) {
+            oss.str(std::string());
+            oss << std::hex << std::showbase << int_value(i) << std::noshowbase << " "
+                << std::oct << i << std::dec << " " << std::scientific << std::uppercase
+                << float_value(i) << std::defaultfloat << std::nouppercase;
+            bench::consume(static_cast<std::size_t>(oss.tellp()));
+        }
+    });
+}
+
+
+
+// Per operation is per element
+void
+bench_arrays(bench::runner &r) {
+    std::vector<unsigned long long> ints(1024);
+    std::vector<double> floats(1024);
+    for (std::size_t i = 0; i < ints.size(); ++i) {
+        ints[i] = int_value(i);
+        floats[i] = float_value(i);
+    }
+
+    auto per_element = [&](auto &values, auto &&format) {
+        return [&values, format](unsigned long n) {
+            std::string out;
+            sio::ref_string_writer sw(out, 32 * values.size());
+            for (unsigned long done = 0; done < n; done += values.size()) {
+                out.clear();
+                format(sw, values);
+                bench::consume(out.size());
+            }
+        };
+    };
+    auto elementwise = [](sio::ref_string_writer &sw, const auto &values) {
+        for (std::size_t i = 0; i < values.size(); ++i) {
+            if (i) sw << " ";
+            sw << values[i];
+        }
+    };
+    auto bulk = [](sio::ref_string_writer &sw, const auto &values) {
+        sw << sio::array(values);
+    };
+    auto shortest = [](sio::ref_string_writer &sw, const auto &values) {
+        sw << sio::array(values, " ", sio::float_repr::shortest);
+    };
+
+    r.run("array", "elementwise", "int", per_element(ints, elementwise));
+    r.run("array", "sio", "int", per_element(ints, bulk));
+    r.run("array", "elementwise", "float", per_element(floats, elementwise));
+    r.run("array", "sio", "float", per_element(floats, bulk));
+    r.run("array", "sio", "float_shortest", per_element(floats, shortest));
+}
+
+
+// Short records through a stream_writer bound to the concrete stream versus the erased interface
+void
+bench_records(bench::runner &r) {
+    auto records = [](auto &&make_writer) {
+        return [make_writer](unsigned long n) {
+            sio::memory_stream ms;
+            auto w = make_writer(ms);
+            for (unsigned long i = 0; i < n; ++i) {
+                if (i % 4096 == 0) ms.seek(0);
+                w << "k=" << static_cast<unsigned>(i) << sio::nl;
+            }
+            bench::consume(static_cast<std::size_t>(ms.tell()));
+        };
+    };
+    r.run("record", "virtual", "memory_stream", records([](sio::memory_stream &ms) {
+        return sio::stream_writer<sio::out_stream>(ms);
+    }));
+    r.run("record", "static", "memory_stream", records([](sio::memory_stream &ms) {
+        return sio::stream_writer<sio::memory_stream>(ms);
+    }));
+}
+
+
+// Debug output that is turned off: formatted into nirvana, or skipped by the runtime level check
+void
+bench_disabled_logging(bench::runner &r) {
+    r.run("disabled_log", "nirvana", "debug", [](unsigned long n) {
+        for (unsigned long i = 0; i < n; ++i) {
+            sio::nirvana << "request " << i << " took " << 0.5 * static_cast<double>(i) << sio::nl;
+        }
+    });
+    r.run("disabled_log", "sio_log", "debug", [](unsigned long n) {
+        for (unsigned long i = 0; i < n; ++i) {
+            SIO_DEBUG("request", sio::kv("id", i), sio::kv("ms", 0.5 * static_cast<double>(i)));
+        }
+        bench::consume(n);
+    });
+}
+
+
+// Per operation is one ISO 8601 timestamp with microseconds; time advances 1us per call
+void
+bench_timestamps(bench::runner &r) {
+    auto start = std::chrono::system_clock::now();
+    r.run("timestamp", "strftime", "iso8601_us", [&](unsigned long n) {
+        char buf[64];
+        for (unsigned long i = 0; i < n; ++i) {
+            auto us = std::chrono::duration_cast<std::chrono::microseconds>(
+                    start.time_since_epoch()).count() + static_cast<long long>(i);
+            auto t = static_cast<std::time_t>(us / 1000000);
+            std::tm tm;
+            gmtime_r(&t, &tm);
+            auto len = std::strftime(buf, sizeof buf, "%Y-%m-%dT%H:%M:%S", &tm);
+            len += static_cast<std::size_t>(std::snprintf(buf + len, sizeof buf - len, ".%06dZ",
+                    static_cast<int>(us % 1000000)));
+            bench::consume(len);
+        }
+    });
+    r.run("timestamp", "sio", "iso8601_us", [&](unsigned long n) {
+        sio::fixed_writer<64> fw;
+        for (unsigned long i = 0; i < n; ++i) {
+            fw.clear();
+            fw << sio::timestamp(start + std::chrono::microseconds(i));
+            bench::consume(fw.size());
+        }
+    });
+}
+
+} // namespace
+
+
+int main(int argc, char **argv) {
+    bench::runner r(argc, argv);
+    bench_integers(r);
+    bench_floats(r);
+    bench_strings(r);
+    bench_enums(r);
+    bench_formatted(r);
+    bench_arrays(r);
+    bench_records(r);
+    bench_disabled_logging(r);
+    bench_timestamps(r);
+}
@@ -0,0 +1,310 @@
+#include "bench.hh"
+#include <sio/stream/file.hh>
+#include <sio/stream/memory.hh>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <thread>
+
+
+volatile std::size_t bench::sink;
+
+
+namespace {
+
+using clock = std::chrono::steady_clock;
+using latencies = std::vector<std::uint32_t>;
+
+
+class xorshift {
+public:
+    explicit xorshift(std::uint64_t seed) noexcept
+        : m_state(seed * 0x9E3779B97F4A7C15ull + 1) {
+    }
+
+    std::uint64_t operator()() noexcept {
+        m_state ^= m_state << 13;
+        m_state ^= m_state >> 7;
+        m_state ^= m_state << 17;
+        return m_state;
+    }
+
+private:
+    std::uint64_t m_state;
+};
+
+
+// Read and write syscalls of the whole process, or -1 where /proc/self/io is unavailable
+long long
+syscall_count() {
+    std::ifstream io("/proc/self/io");
+    if (!io) return -1;
+    long long total = 0;
+    std::string key;
+    long long value;
+    while (io >> key >> value) {
+        if (key == "syscr:" || key == "syscw:") total += value;
+    }
+    return total;
+}
+
+
+template<typename Op>
+void
+timed(latencies &lat, Op &&op) {
+    auto start = clock::now();
+    op();
+    lat.push_back(static_cast<std::uint32_t>(std::min<long long>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start).count(),
+            UINT32_MAX)));
+}
+
+
+template<typename Stream>
+void
+seq_write(Stream &s, std::vector<char> &buf, std::size_t bytes, xorshift &, latencies &lat) {
+    for (std::size_t done = 0; done < bytes; done += buf.size()) {
+        timed(lat, [&] { bench::consume(s.put(buf.data(), buf.size())); });
+    }
+    timed(lat, [&] { s.flush(); });
+}
+
+
+template<typename Stream>
+void
+seq_read(Stream &s, std::vector<char> &buf, std::size_t bytes, xorshift &, latencies &lat) {
+    s.seek_get(0);
+    for (std::size_t done = 0; done < bytes; done += buf.size()) {
+        timed(lat, [&] { bench::consume(s.get(buf.data(), buf.size())); });
+    }
+}
+
+
+template<typename Stream>
+void
+random_read(Stream &s, std::vector<char> &buf, std::size_t bytes, xorshift &rng,
+        latencies &lat) {
+    auto chunks = bytes / buf.size();
+    for (std::size_t i = 0; i < chunks; ++i) {
+        auto pos = static_cast<sio::stream_pos>(rng() % chunks * buf.size());
+        timed(lat, [&] {
+            s.seek_get(pos);
+            bench::consume(s.get(buf.data(), buf.size()));
+        });
+    }
+}
+
+
+template<typename Stream>
+void
+mixed(Stream &s, std::vector<char> &buf, std::size_t bytes, xorshift &rng, latencies &lat) {
+    auto chunks = bytes / buf.size();
+    for (std::size_t i = 0; i < chunks; ++i) {
+        auto r = rng();
+        auto pos = static_cast<sio::stream_pos>((r >> 1) % chunks * buf.size());
+        if (r & 1) {
+            timed(lat, [&] {
+                s.seek_put(pos);
+                bench::consume(s.put(buf.data(), buf.size()));
+            });
+        } else {
+            timed(lat, [&] {
+                s.seek_get(pos);
+                bench::consume(s.get(buf.data(), buf.size()));
+            });
+        }
+    }
+    timed(lat, [&] { s.flush(); });
+}
+
+
+struct config {
+    std::string backend, dir, scenario;
+    std::size_t chunk, threads, bytes;
+};
+
+
+class stream_bench {
+public:
+    stream_bench(const bench::options &opts, bench::report &rep)
+        : m_opts(opts), m_report(rep) {
+    }
+
+    // body(thread_index, buffer, rng, latencies) runs on each thread after the start barrier
+    template<typename Body>
+    void run(const config &c, Body &&body) {
+        if (!m_opts.selected(c.backend + "/" + c.scenario + "/" + std::to_string(c.chunk))) {
+            return;
+        }
+
+        latencies all;
+        double seconds = 0;
+        long long syscalls = 0;
+        for (unsigned long rep = 0; rep < m_opts.warmup + m_opts.reps; ++rep) {
+            std::vector<latencies> lat(c.threads);
+            std::atomic<std::size_t> ready { 0 };
+            std::atomic<bool> go { false };
+            std::vector<std::thread> threads;
+            for (std::size_t t = 0; t < c.threads; ++t) {
+                threads.emplace_back([&, t] {
+                    std::vector<char> buf(c.chunk, 'x');
+                    xorshift rng(t + 1);
+                    lat[t].reserve(c.bytes / c.threads / c.chunk + 2);
+                    body(t, buf, rng, lat[t], [&] {
+                        ++ready;
+                        while (!go.load(std::memory_order_acquire)) std::this_thread::yield();
+                    });
+                });
+            }
+            while (ready.load() < c.threads) std::this_thread::yield();
+
+            auto sys_before = syscall_count();
+            auto start = clock::now();
+            go.store(true, std::memory_order_release);
+            for (auto &t : threads) t.join();
+            auto elapsed = std::chrono::duration<double>(clock::now() - start).count();
+            auto sys_after = syscall_count();
+
+            if (rep >= m_opts.warmup) {
+                seconds += elapsed;
+                syscalls = sys_before < 0 ? -1 : syscalls + (sys_after - sys_before);
+                for (auto &l : lat) all.insert(all.end(), l.begin(), l.end());
+            }
+        }
+
+        std::sort(all.begin(), all.end());
+        auto percentile = [&](double q) -> std::uint32_t {
+            if (all.empty()) return 0;
+            return all[std::min(all.size() - 1, static_cast<std::size_t>(q * all.size()))];
+        };
+        double reps = static_cast<double>(m_opts.reps);
+        double total_bytes = static_cast<double>(c.bytes) * reps;
+        m_report.row(c.backend, c.dir, c.scenario, c.chunk, c.threads, c.bytes,
+                seconds / reps, total_bytes / seconds / 1e6,
+                syscalls < 0 ? -1.0 : static_cast<double>(syscalls) / reps,
+                percentile(.5), percentile(.9), percentile(.99), percentile(1));
+    }
+
+private:
+    const bench::options &m_opts;
+    bench::report &m_report;
+};
+
+
+void
+bench_file(stream_bench &b, const std::string &dir, std::size_t chunk, std::size_t threads,
+        std::size_t bytes) {
+    auto per_thread = bytes / threads;
+    auto path = [&](std::size_t t) {
+        return dir + "/sio-bench-" + std::to_string(t) + ".dat";
+    };
+    config c { "file", dir, "", chunk, threads, per_thread * threads };
+
+    c.scenario = "seq_write";
+    b.run(c, [&](std::size_t t, std::vector<char> &buf, xorshift &rng, latencies &lat,
+            auto &&start) {
+        sio::file_out_stream s(path(t));
+        start();
+        seq_write(s, buf, per_thread, rng, lat);
+    });
+
+    auto read_body = [&](auto scenario) {
+        return [&, scenario](std::size_t t, std::vector<char> &buf, xorshift &rng,
+                latencies &lat, auto &&start) {
+            sio::file_read_stream s(path(t));
+            start();
+            scenario(s, buf, per_thread, rng, lat);
+        };
+    };
+    c.scenario = "seq_read";
+    b.run(c, read_body([](auto &... a) { seq_read(a...); }));
+    c.scenario = "random_read";
+    b.run(c, read_body([](auto &... a) { random_read(a...); }));
+
+    c.scenario = "mixed";
+    b.run(c, [&](std::size_t t, std::vector<char> &buf, xorshift &rng, latencies &lat,
+            auto &&start) {
+        sio::file_rw_stream s(path(t), sio::open_mode::overwrite);
+        start();
+        mixed(s, buf, per_thread, rng, lat);
+    });
+
+    for (std::size_t t = 0; t < threads; ++t) {
+        std::remove(path(t).c_str());
+    }
+}
+
+
+void
+bench_memory(stream_bench &b, std::size_t chunk, std::size_t threads, std::size_t bytes) {
+    auto per_thread = bytes / threads;
+    std::vector<std::unique_ptr<sio::memory_stream>> streams;
+    for (std::size_t t = 0; t < threads; ++t) {
+        streams.emplace_back(new sio::memory_stream);
+    }
+    config c { "memory", "-", "", chunk, threads, per_thread * threads };
+
+    c.scenario = "seq_write";
+    b.run(c, [&](std::size_t t, std::vector<char> &buf, xorshift &rng, latencies &lat,
+            auto &&start) {
+        auto &s = *streams[t];
+        s.seek_put(0);
+        start();
+        seq_write(s, buf, per_thread, rng, lat);
+    });
+
+    auto body = [&](auto scenario) {
+        return [&, scenario](std::size_t t, std::vector<char> &buf, xorshift &rng,
+                latencies &lat, auto &&start) {
+            auto &s = *streams[t];
+            start();
+            scenario(s, buf, per_thread, rng, lat);
+        };
+    };
+    c.scenario = "seq_read";
+    b.run(c, body([](auto &... a) { seq_read(a...); }));
+    c.scenario = "random_read";
+    b.run(c, body([](auto &... a) { random_read(a...); }));
+    c.scenario = "mixed";
+    b.run(c, body([](auto &... a) { mixed(a...); }));
+}
+
+} // namespace
+
+
+int main(int argc, char **argv) {
+    std::vector<std::string> dirs;
+    std::size_t bytes = 16 << 20;
+    bench::options opts(argc, argv, " [--dir PATH]... [--bytes N]",
+            [&](const std::string &arg, auto &next) {
+                if (arg == "--dir") {
+                    dirs.push_back(next());
+                } else if (arg == "--bytes") {
+                    bytes = std::strtoull(next().c_str(), nullptr, 10);
+                } else {
+                    return false;
+                }
+                return true;
+            });
+    if (dirs.empty()) {
+        if (std::ofstream("/dev/shm/sio-bench-probe")) {
+            std::remove("/dev/shm/sio-bench-probe");
+            dirs.push_back("/dev/shm");
+        }
+        dirs.push_back(".");
+    }
+
+    bench::report rep(opts.json, { "backend", "dir", "scenario", "chunk", "threads", "bytes",
+            "seconds", "mb_per_s", "syscalls", "p50_ns", "p90_ns", "p99_ns", "max_ns" });
+    stream_bench b(opts, rep);
+    for (std::size_t chunk : { 16, 256, 4096, 65536 }) {
+        for (std::size_t threads : { 1, 2, 4 }) {
+            for (auto &dir : dirs) {
+                bench_file(b, dir, chunk, threads, bytes);
+            }
+            bench_memory(b, chunk, threads, bytes);
+        }
+    }
+}
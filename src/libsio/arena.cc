@@ -0,0 +1,74 @@
+#include <sio/writer/arena.hh>
+#include <algorithm>
+
+using namespace sio;
+
+
+arena::arena(std::size_t block_size)
+    : m_block_size(std::max<std::size_t>(block_size, 64)) {
+}
+
+
+void
+arena::next_block(std::size_t n) {
+    if (!m_blocks.empty()) {
+        ++m_current;
+    }
+    if (m_current >= m_blocks.size() || m_blocks[m_current].size < n) {
+        // Oversized requests get slack so that a string growing past the block size does not
+        // need a fresh block on every write
+        auto size = n > m_block_size ? 2 * n : m_block_size;
+        block b { std::unique_ptr<char[]>(new char[size]), size };
+        m_blocks.insert(m_blocks.begin() + static_cast<std::ptrdiff_t>(m_current), std::move(b));
+    }
+    m_pos = m_blocks[m_current].data.get();
+    m_end = m_pos + m_blocks[m_current].size;
+}
+
+
+char *
+arena::allocate(std::size_t n) {
+    if (static_cast<std::size_t>(m_end - m_pos) < n) {
+        next_block(n);
+    }
+    char *p = m_pos;
+    m_pos += n;
+    return p;
+}
+
+
+char *
+arena::grow(char *last, std::size_t old_size, std::size_t new_size) {
+    if (last && last + old_size == m_pos
+            && static_cast<std::size_t>(m_end - last) >= new_size) {
+        m_pos = last + new_size;
+        return last;
+    }
+    char *p = allocate(new_size);
+    if (old_size) {
+        std::memcpy(p, last, old_size);
+    }
+    return p;
+}
+
+
+void
+arena::reset() noexcept {
+    m_current = 0;
+    if (m_blocks.empty()) {
+        m_pos = m_end = nullptr;
+    } else {
+        m_pos = m_blocks[0].data.get();
+        m_end = m_pos + m_blocks[0].size;
+    }
+}
+
+
+std::size_t
+arena::capacity() const noexcept {
+    std::size_t total = 0;
+    for (auto &b : m_blocks) {
+        total += b.size;
+    }
+    return total;
+}
@@ -0,0 +1,228 @@
+#include <sio/stream/async.hh>
+
+#ifdef SIO_ASYNC
+
+#include <cerrno>
+#include <stdexcept>
+#include <system_error>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+using namespace sio;
+
+
+// Owns itself: starts suspended so that spawn() can queue it, and frees itself when done
+class event_loop::detached {
+public:
+    struct promise_type {
+        detached get_return_object() noexcept {
+            return detached { std::coroutine_handle<promise_type>::from_promise(*this) };
+        }
+
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+
+event_loop::event_loop()
+    : m_epoll(::epoll_create1(EPOLL_CLOEXEC)) {
+    if (m_epoll < 0) throw std::system_error(errno, std::generic_category(), "epoll_create1");
+}
+
+
+event_loop::~event_loop() {
+    // Coroutines that never finished are still suspended somewhere; destroying queued frames
+    // would leave others dangling, so they are leaked along with their tasks
+    ::close(m_epoll);
+}
+
+
+event_loop::detached
+event_loop::drive(event_loop &loop, task<void> t) {
+    try {
+        co_await std::move(t);
+    } catch (...) {
+        if (!loop.m_error) loop.m_error = std::current_exception();
+    }
+    --loop.m_live;
+}
+
+
+void
+event_loop::spawn(task<void> t) {
+    ++m_live;
+    m_ready.push_back(drive(*this, std::move(t)).handle);
+}
+
+
+void
+event_loop::run() {
+    m_stopped = false;
+    while (!m_stopped && m_live > 0) {
+        while (!m_ready.empty() && !m_stopped) {
+            auto h = m_ready.front();
+            m_ready.pop_front();
+            h.resume();
+        }
+        if (m_stopped || m_live == 0) break;
+        if (m_ready.empty()) {
+            if (m_waiting == 0) {
+                throw std::logic_error("sio::event_loop: tasks are suspended but nothing can "
+                        "resume them");
+            }
+            poll();
+        }
+    }
+    if (m_error) std::rethrow_exception(std::exchange(m_error, nullptr));
+}
+
+
+void
+event_loop::watch(int fd, bool write, std::coroutine_handle<> h) {
+    auto &w = m_watches[fd];
+    auto &slot = write ? w.writer : w.reader;
+    if (slot) {
+        throw std::logic_error(write ? "sio::event_loop: descriptor already has a writer waiting"
+                : "sio::event_loop: descriptor already has a reader waiting");
+    }
+    slot = h;
+    try {
+        update(fd, w);
+    } catch (...) {
+        slot = nullptr;
+        throw;
+    }
+    ++m_waiting;
+}
+
+
+void
+event_loop::update(int fd, watch_state &w) {
+    unsigned events = (w.reader ? EPOLLIN : 0u) | (w.writer ? EPOLLOUT : 0u);
+    if (w.added ? events == w.registered : events == 0) return;
+
+    // Even an empty mask reports EPOLLHUP and EPOLLERR, which would wake every poll for a
+    // hung-up descriptor nobody waits on, so idle descriptors leave the set
+    if (events == 0) {
+        ::epoll_ctl(m_epoll, EPOLL_CTL_DEL, fd, nullptr);
+        w.added = false;
+        return;
+    }
+
+    epoll_event ev {};
+    ev.events = events;
+    ev.data.fd = fd;
+    if (::epoll_ctl(m_epoll, w.added ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, fd, &ev) != 0) {
+        throw std::system_error(errno, std::generic_category(), "epoll_ctl");
+    }
+    w.added = true;
+    w.registered = events;
+}
+
+
+void
+event_loop::forget(int fd) noexcept {
+    auto it = m_watches.find(fd);
+    if (it == m_watches.end()) return;
+    ::epoll_ctl(m_epoll, EPOLL_CTL_DEL, fd, nullptr);
+    // Waiters are resumed rather than dropped, so that they see the descriptor gone instead of
+    // staying suspended with nothing left to wake them
+    for (auto h : { it->second.reader, it->second.writer }) {
+        if (h) {
+            m_ready.push_back(h);
+            --m_waiting;
+        }
+    }
+    m_watches.erase(it);
+}
+
+
+void
+event_loop::poll() {
+    epoll_event events[64];
+    int n;
+    do {
+        n = ::epoll_wait(m_epoll, events, 64, -1);
+    } while (n < 0 && errno == EINTR);
+    if (n < 0) throw std::system_error(errno, std::generic_category(), "epoll_wait");
+
+    for (int i = 0; i < n; ++i) {
+        auto it = m_watches.find(events[i].data.fd);
+        if (it == m_watches.end()) continue;
+        auto &w = it->second;
+        auto ev = events[i].events;
+        bool failed = ev & (EPOLLERR | EPOLLHUP);
+        if (w.reader && (failed || (ev & EPOLLIN))) {
+            m_ready.push_back(std::exchange(w.reader, nullptr));
+            --m_waiting;
+        }
+        if (w.writer && (failed || (ev & EPOLLOUT))) {
+            m_ready.push_back(std::exchange(w.writer, nullptr));
+            --m_waiting;
+        }
+        update(it->first, w);
+    }
+}
+
+
+async_fd_stream::async_fd_stream(event_loop &loop, int fd, bool owned)
+    : fd_stream(fd, owned), m_loop(loop) {
+}
+
+
+async_fd_stream::~async_fd_stream() {
+    close();
+}
+
+
+void
+async_fd_stream::close() noexcept {
+    if (fd() < 0) return;
+    m_loop.forget(fd());
+    fd_stream::close();
+}
+
+
+task<std::size_t>
+async_fd_stream::async_get(void *out, std::size_t bytes) {
+    for (;;) {
+        auto r = read_some(out, bytes);
+        m_status = r.status;
+        if (r.status != io_status::would_block) co_return r.bytes;
+        co_await m_loop.readable(fd());
+        if (fd() < 0) throw std::system_error(EBADF, std::generic_category(), "read");
+    }
+}
+
+
+task<std::size_t>
+async_fd_stream::async_put(const void *in, std::size_t bytes) {
+    auto data = static_cast<const char*>(in);
+    std::size_t done = 0;
+    while (done < bytes) {
+        auto r = write_some(data + done, bytes - done);
+        m_status = r.status;
+        done += r.bytes;
+        if (r.status == io_status::eof) {
+            throw std::system_error(EPIPE, std::generic_category(), "write");
+        }
+        if (r.status == io_status::would_block) {
+            co_await m_loop.writable(fd());
+            if (fd() < 0) throw std::system_error(EBADF, std::generic_category(), "write");
+        }
+    }
+    co_return done;
+}
+
+
+task<void>
+async_fd_stream::async_flush() {
+    co_return;
+}
+
+#endif // SIO_ASYNC
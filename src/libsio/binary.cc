@@ -0,0 +1,132 @@
+#include <sio/stream/binary.hh>
+#include <algorithm>
+#include <cerrno>
+#include <system_error>
+
+using namespace sio;
+
+
+binary_writer::binary_writer(out_stream &out, std::size_t buffer_size)
+    : m_out(out), m_buffer(std::max<std::size_t>(buffer_size, max_varint)) {
+}
+
+
+binary_writer::~binary_writer() {
+    try {
+        flush();
+    } catch (...) {
+    }
+}
+
+
+std::size_t
+binary_writer::put_some(const char *data, std::size_t bytes) {
+    auto n = m_out.put(data, bytes);
+    if (n == 0) throw std::system_error(EPIPE, std::generic_category(), "sio::binary_writer: put");
+    m_flushed += n;
+    return n;
+}
+
+
+void
+binary_writer::flush() {
+    std::size_t done = 0;
+    try {
+        while (done < m_size) {
+            done += put_some(m_buffer.data() + done, m_size - done);
+        }
+    } catch (...) {
+        // Keep only what the stream has not taken, so that a retry does not repeat bytes
+        std::memmove(m_buffer.data(), m_buffer.data() + done, m_size - done);
+        m_size -= done;
+        throw;
+    }
+    m_size = 0;
+}
+
+
+void
+binary_writer::put_bytes(const void *data, std::size_t bytes) {
+    if (m_size + bytes > m_buffer.size()) {
+        flush();
+        if (bytes >= m_buffer.size()) {
+            auto p = static_cast<const char*>(data);
+            while (bytes > 0) {
+                auto n = put_some(p, bytes);
+                p += n;
+                bytes -= n;
+            }
+            return;
+        }
+    }
+    std::memcpy(m_buffer.data() + m_size, data, bytes);
+    m_size += bytes;
+}
+
+
+binary_reader::binary_reader(in_stream &in, std::size_t buffer_size)
+    : m_in(in), m_buffer(std::max<std::size_t>(buffer_size, binary_writer::max_varint)) {
+}
+
+
+void
+binary_reader::refill(std::size_t bytes) {
+    std::size_t kept = m_end - m_pos;
+    std::memmove(m_buffer.data(), m_buffer.data() + m_pos, kept);
+    m_consumed += m_pos;
+    m_pos = 0;
+    m_end = kept;
+    while (m_end < bytes) {
+        auto n = m_in.get(m_buffer.data() + m_end, m_buffer.size() - m_end);
+        if (n == 0) throw decode_error("sio::binary_reader: unexpected end of stream");
+        m_end += n;
+    }
+}
+
+
+std::uint64_t
+binary_reader::get_varint_slow() {
+    std::uint64_t v = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+        auto byte = static_cast<unsigned char>(*require(1));
+        ++m_pos;
+        if (shift == 63 && byte > 1) break;
+        v |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return v;
+    }
+    throw decode_error("sio::binary_reader: varint overflows 64 bits");
+}
+
+
+void
+binary_reader::get_bytes(void *data, std::size_t bytes) {
+    auto out = static_cast<char*>(data);
+    auto buffered = std::min(bytes, m_end - m_pos);
+    std::memcpy(out, m_buffer.data() + m_pos, buffered);
+    m_pos += buffered;
+    out += buffered;
+    bytes -= buffered;
+
+    // Large remainders bypass the buffer
+    while (bytes >= m_buffer.size()) {
+        auto n = m_in.get(out, bytes);
+        if (n == 0) throw decode_error("sio::binary_reader: unexpected end of stream");
+        m_consumed += n;
+        out += n;
+        bytes -= n;
+    }
+    if (bytes > 0) {
+        std::memcpy(out, require(bytes), bytes);
+        m_pos += bytes;
+    }
+}
+
+
+bool
+binary_reader::at_end() {
+    if (m_pos < m_end) return false;
+    m_consumed += m_pos;
+    m_pos = m_end = 0;
+    m_end = m_in.get(m_buffer.data(), m_buffer.size());
+    return m_end == 0;
+}
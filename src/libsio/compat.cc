@@ -0,0 +1,92 @@
+#include <sio/writer/compat.hh>
+#include <locale>
+
+using namespace sio;
+
+
+writeable_streambuf::int_type
+writeable_streambuf::overflow(int_type c) {
+    sync();
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+        *pptr() = traits_type::to_char_type(c);
+        pbump(1);
+    }
+    return traits_type::not_eof(c);
+}
+
+
+std::streamsize
+writeable_streambuf::xsputn(const char *seq, std::streamsize n) {
+    if (n <= epptr() - pptr()) {
+        traits_type::copy(pptr(), seq, static_cast<std::size_t>(n));
+        pbump(static_cast<int>(n));
+    } else {
+        sync();
+        m_target->write(seq, static_cast<std::size_t>(n));
+    }
+    return n;
+}
+
+
+int
+writeable_streambuf::sync() {
+    if (pptr() != pbase()) {
+        m_target->write(pbase(), static_cast<std::size_t>(pptr() - pbase()));
+        setp(m_buf, m_buf + sizeof m_buf);
+    }
+    return 0;
+}
+
+
+struct ostream_bridge::slot {
+    writeable_streambuf buf;
+    std::ostream stream { &buf };
+    bool in_use = false;
+
+    // std::ostream swallows exceptions from the streambuf and only sets badbit, unless asked
+    // to rethrow them; a failing target writer must not go unnoticed
+    slot() {
+        stream.exceptions(std::ios_base::badbit);
+    }
+};
+
+
+ostream_bridge::ostream_bridge(writeable &w) {
+    thread_local slot cached;
+    if (!cached.in_use) {
+        m_slot = &cached;
+    } else {
+        // operator<< of the value being written is itself writing through the bridge
+        m_owned = std::make_unique<slot>();
+        m_slot = m_owned.get();
+    }
+    m_slot->in_use = true;
+    m_slot->buf.bind(w);
+
+    auto &stream = m_slot->stream;
+    stream.clear();
+    stream.flags(std::ios_base::dec | std::ios_base::skipws);
+    stream.precision(6);
+    stream.width(0);
+    stream.fill(' ');
+    if (stream.getloc() != w.locale()) {
+        stream.imbue(w.locale());
+    }
+}
+
+
+ostream_bridge::~ostream_bridge() {
+    m_slot->in_use = false;
+}
+
+
+std::ostream &
+ostream_bridge::stream() noexcept {
+    return m_slot->stream;
+}
+
+
+void
+ostream_bridge::flush() {
+    m_slot->buf.pubsync();
+}
@@ -0,0 +1,262 @@
+#include <config.h>
+#include <sio/stream/direct.hh>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <system_error>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace sio;
+
+
+static std::size_t
+round_up(std::size_t n, std::size_t align) {
+    return (n + align - 1) / align * align;
+}
+
+
+static std::size_t
+round_down(std::size_t n, std::size_t align) {
+    return n / align * align;
+}
+
+
+[[noreturn]] static void
+throw_errno(const std::string &what) {
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+
+direct_out_stream::direct_out_stream(const std::string &fname, open_mode mode,
+        const direct_options &opts)
+    : m_alignment(std::max<std::size_t>(opts.alignment, 1)),
+      m_capacity(round_up(std::max(opts.buffer_size, m_alignment), m_alignment)),
+      m_window(opts.writeback_window) {
+    // Read access lets direct mode merge partial blocks with existing file contents
+    int flags = O_RDWR | O_CREAT | O_CLOEXEC;
+    if (mode == open_mode::truncate) flags |= O_TRUNC;
+
+#ifdef O_DIRECT
+    if (opts.direct) {
+        m_fd = ::open(fname.c_str(), flags | O_DIRECT, 0666);
+        m_direct = m_fd >= 0;
+        if (m_fd < 0 && errno != EINVAL) throw_errno("open " + fname);
+    }
+#endif
+    if (m_fd < 0) {
+        m_fd = ::open(fname.c_str(), flags, 0666);
+        if (m_fd < 0) throw_errno("open " + fname);
+    }
+
+    // One spare block after the staging area receives partial blocks read back from the file
+    void *buf;
+    if (posix_memalign(&buf, std::max(m_alignment, sizeof(void*)), m_capacity + m_alignment)) {
+        ::close(m_fd);
+        throw std::bad_alloc();
+    }
+    m_buffer.reset(static_cast<char*>(buf));
+
+    struct stat st;
+    if (::fstat(m_fd, &st) != 0) {
+        int err = errno;
+        ::close(m_fd);
+        throw std::system_error(err, std::generic_category(), "stat " + fname);
+    }
+    m_file_size = static_cast<stream_pos>(st.st_size);
+    auto start = mode == open_mode::append ? m_file_size : 0;
+    m_offset = m_direct ? round_down(start, m_alignment) : start;
+    m_writeback_begin = m_writeback_end = m_offset;
+    if (start > m_offset) {
+        // Appending in direct mode rewrites the partial last block, so stage its contents
+        m_fill = start - m_offset;
+        ssize_t r;
+        do {
+            r = ::pread(m_fd, m_buffer.get(), m_alignment, static_cast<off_t>(m_offset));
+        } while (r < 0 && errno == EINTR);
+        if (r < static_cast<ssize_t>(m_fill)) {
+            int err = r < 0 ? errno : EIO;
+            ::close(m_fd);
+            throw std::system_error(err, std::generic_category(), "pread " + fname);
+        }
+    }
+
+#ifdef SIO_STATS
+    m_syscall_counter = &m_syscalls;
+#endif
+}
+
+
+direct_out_stream::~direct_out_stream() {
+    try {
+        close();
+    } catch (...) {
+    }
+}
+
+
+void
+direct_out_stream::close() {
+    if (m_fd < 0) return;
+
+    int fd = m_fd;
+    try {
+        drain(true);
+    } catch (...) {
+        m_fd = -1;
+        ::close(fd);
+        throw;
+    }
+    m_fd = -1;
+    if (::close(fd) != 0) throw_errno("close");
+}
+
+
+std::size_t
+direct_out_stream::v_put(const void *in, std::size_t bytes) {
+    auto src = static_cast<const char*>(in);
+
+    if (!m_direct && m_fill == 0 && bytes >= m_capacity) {
+        write_at(src, bytes, m_offset);
+        m_offset += bytes;
+        pace();
+        return bytes;
+    }
+
+    for (std::size_t left = bytes; left > 0;) {
+        auto n = std::min(left, m_capacity - m_fill);
+        std::memcpy(m_buffer.get() + m_fill, src, n);
+        m_fill += n;
+        src += n;
+        left -= n;
+        if (m_fill == m_capacity) drain(false);
+    }
+    return bytes;
+}
+
+
+void
+direct_out_stream::v_flush() {
+    drain(true);
+}
+
+
+// Reads the file block at m_buffer + block_start and fills the bytes past m_fill from it,
+// so that writing the padded block preserves what the file held beyond our data
+void
+direct_out_stream::merge_tail_block(std::size_t block_start) {
+    auto block = m_buffer.get() + block_start;
+    auto used = m_fill - block_start;
+    auto file_pos = m_offset + block_start;
+    std::size_t got = 0;
+
+    if (file_pos + used < m_file_size) {
+        auto scratch = m_buffer.get() + m_capacity;
+        for (;;) {
+            auto r = ::pread(m_fd, scratch, m_alignment, static_cast<off_t>(file_pos));
+            if (r >= 0) {
+                got = static_cast<std::size_t>(r);
+                break;
+            }
+            if (errno != EINTR) throw_errno("pread");
+        }
+#ifdef SIO_STATS
+        ++m_syscalls;
+#endif
+        if (got > used) std::memcpy(block + used, scratch + used, got - used);
+    }
+    if (std::max(got, used) < m_alignment) {
+        std::memset(block + std::max(got, used), 0, m_alignment - std::max(got, used));
+    }
+}
+
+
+// Writes whole blocks; with tail, also the final partial block, which stays buffered so that
+// later puts complete it in place
+void
+direct_out_stream::drain(bool tail) {
+    if (m_fd < 0) return;
+
+    if (!m_direct) {
+        if (m_fill > 0) {
+            write_at(m_buffer.get(), m_fill, m_offset);
+            m_offset += m_fill;
+            m_fill = 0;
+        }
+        pace();
+        return;
+    }
+
+    auto whole = round_down(m_fill, m_alignment);
+    auto n = tail ? round_up(m_fill, m_alignment) : whole;
+    if (n > whole) merge_tail_block(whole);
+    if (n > 0) write_at(m_buffer.get(), n, m_offset);
+
+    auto end = m_offset + m_fill;
+    m_padded_end = std::max(m_padded_end, m_offset + n);
+    m_file_size = std::max(m_file_size, end);
+    if (tail && m_padded_end > m_file_size) {
+        if (::ftruncate(m_fd, static_cast<off_t>(m_file_size)) != 0) throw_errno("ftruncate");
+#ifdef SIO_STATS
+        ++m_syscalls;
+#endif
+        m_padded_end = m_file_size;
+    }
+
+    std::memmove(m_buffer.get(), m_buffer.get() + whole, m_fill - whole);
+    m_offset += whole;
+    m_fill -= whole;
+}
+
+
+void
+direct_out_stream::write_at(const char *data, std::size_t bytes, stream_pos offset) {
+    while (bytes > 0) {
+        auto r = ::pwrite(m_fd, data, bytes, static_cast<off_t>(offset));
+#ifdef SIO_STATS
+        ++m_syscalls;
+#endif
+        if (r < 0) {
+            if (errno == EINTR) continue;
+            throw_errno("pwrite");
+        }
+        data += r;
+        bytes -= static_cast<std::size_t>(r);
+        offset += static_cast<stream_pos>(r);
+    }
+}
+
+
+// Keeps at most two windows of dirty pages: the newest is queued for write-back, the one
+// before it is waited for and evicted from the page cache
+void
+direct_out_stream::pace() {
+#ifdef HAVE_SYNC_FILE_RANGE
+    if (m_window == 0 || m_offset - m_writeback_end < m_window) return;
+
+    ::sync_file_range(m_fd, static_cast<off_t>(m_writeback_end),
+            static_cast<off_t>(m_offset - m_writeback_end), SYNC_FILE_RANGE_WRITE);
+#ifdef SIO_STATS
+    ++m_syscalls;
+#endif
+    if (m_writeback_end > m_writeback_begin) {
+        auto begin = static_cast<off_t>(m_writeback_begin);
+        auto len = static_cast<off_t>(m_writeback_end - m_writeback_begin);
+        ::sync_file_range(m_fd, begin, len, SYNC_FILE_RANGE_WAIT_BEFORE
+                | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER);
+#ifdef SIO_STATS
+        ++m_syscalls;
+#endif
+#ifdef HAVE_POSIX_FADVISE
+        ::posix_fadvise(m_fd, begin, len, POSIX_FADV_DONTNEED);
+#ifdef SIO_STATS
+        ++m_syscalls;
+#endif
+#endif
+    }
+    m_writeback_begin = m_writeback_end;
+    m_writeback_end = m_offset;
+#endif
+}
@@ -0,0 +1,202 @@
+#include <config.h>
+#include <sio/stream/durable.hh>
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace sio;
+
+
+class durable_out_stream::syncer {
+public:
+    syncer(const std::string &fname, open_mode mode, std::size_t buffer_size)
+        : m_capacity(std::max<std::size_t>(buffer_size, 1)) {
+        int flags = O_WRONLY | O_CREAT | O_CLOEXEC;
+        if (mode == open_mode::append) flags |= O_APPEND;
+        if (mode == open_mode::truncate) flags |= O_TRUNC;
+        m_fd = ::open(fname.c_str(), flags, 0666);
+        if (m_fd < 0) {
+            throw std::system_error(errno, std::generic_category(), "open " + fname);
+        }
+        m_buffer.reserve(m_capacity);
+        m_thread = std::thread([this] { run(); });
+    }
+
+    ~syncer() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_wake.notify_all();
+        m_thread.join();
+        ::close(m_fd);
+    }
+
+    void put(const char *data, std::size_t bytes) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_buffer.size() + bytes > m_capacity) {
+            drain();
+            if (bytes >= m_capacity) {
+                write_all(data, bytes);
+                return;
+            }
+        }
+        m_buffer.insert(m_buffer.end(), data, data + bytes);
+    }
+
+    void flush() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        drain();
+    }
+
+    std::future<void> commit() {
+        std::promise<void> done;
+        auto result = done.get_future();
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_error) {
+            done.set_exception(m_error);
+            return result;
+        }
+        try {
+            drain();
+        } catch (...) {
+            done.set_exception(std::current_exception());
+            return result;
+        }
+        if (m_durable >= m_written) {
+            done.set_value();
+        } else {
+            m_waiting.push_back(std::move(done));
+            m_wake.notify_all();
+        }
+        return result;
+    }
+
+    std::uint64_t syncs() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_syncs;
+    }
+
+private:
+    // Requires m_mutex
+    void drain() {
+        if (m_buffer.empty()) return;
+        write_all(m_buffer.data(), m_buffer.size());
+        m_buffer.clear();
+    }
+
+    // Requires m_mutex
+    void write_all(const char *data, std::size_t bytes) {
+        while (bytes > 0) {
+            auto r = ::write(m_fd, data, bytes);
+            if (r < 0) {
+                if (errno == EINTR) continue;
+                throw std::system_error(errno, std::generic_category(), "write");
+            }
+            data += r;
+            bytes -= static_cast<std::size_t>(r);
+            m_written += static_cast<std::uint64_t>(r);
+        }
+    }
+
+    // Every commit waiting when a sync starts is covered by it, since its data was written
+    // before it queued. Commits arriving during the sync form the next batch
+    void run() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        for (;;) {
+            m_wake.wait(lock, [&] { return m_stop || !m_waiting.empty(); });
+            if (m_waiting.empty()) return;
+
+            auto batch = std::move(m_waiting);
+            m_waiting.clear();
+            auto target = m_written;
+            lock.unlock();
+
+#ifdef HAVE_FDATASYNC
+            int rc = ::fdatasync(m_fd);
+#else
+            int rc = ::fsync(m_fd);
+#endif
+            int err = errno;
+
+            lock.lock();
+            ++m_syncs;
+            if (rc == 0 && !m_error) {
+                m_durable = target;
+            } else if (!m_error) {
+                m_error = std::make_exception_ptr(
+                        std::system_error(err, std::generic_category(), "fdatasync"));
+            }
+            for (auto &p : batch) {
+                if (m_error) {
+                    p.set_exception(m_error);
+                } else {
+                    p.set_value();
+                }
+            }
+        }
+    }
+
+    int m_fd;
+    std::size_t m_capacity;
+    std::vector<char> m_buffer;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::vector<std::promise<void>> m_waiting;
+    std::uint64_t m_written = 0;
+    std::uint64_t m_durable = 0;
+    std::uint64_t m_syncs = 0;
+    std::exception_ptr m_error;
+    bool m_stop = false;
+    std::thread m_thread;
+};
+
+
+durable_out_stream::durable_out_stream(const std::string &fname, open_mode mode,
+        std::size_t buffer_size)
+    : m_syncer(new syncer(fname, mode, buffer_size)) {
+}
+
+
+durable_out_stream::~durable_out_stream() {
+    try {
+        sync();
+    } catch (...) {
+    }
+}
+
+
+std::future<void>
+durable_out_stream::commit() {
+    return m_syncer->commit();
+}
+
+
+std::uint64_t
+durable_out_stream::syncs() const {
+    return m_syncer->syncs();
+}
+
+
+std::size_t
+durable_out_stream::v_put(const void *in, std::size_t bytes) {
+    m_syncer->put(static_cast<const char*>(in), bytes);
+    return bytes;
+}
+
+
+void
+durable_out_stream::v_flush() {
+    m_syncer->flush();
+}
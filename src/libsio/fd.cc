@@ -0,0 +1,219 @@
+#include <sio/stream/fd.hh>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace sio;
+
+
+fd_stream::fd_stream(int fd, bool owned)
+    : m_fd(fd), m_owned(owned) {
+    int flags = ::fcntl(fd, F_GETFL);
+    if (flags < 0 || (!(flags & O_NONBLOCK) && ::fcntl(fd, F_SETFL, flags | O_NONBLOCK) != 0)) {
+        // The destructor does not run for a throwing constructor, so an owned fd is closed here
+        int err = errno;
+        if (m_owned) ::close(fd);
+        throw std::system_error(err, std::generic_category(), "fcntl");
+    }
+    struct stat st;
+    m_socket = ::fstat(fd, &st) == 0 && S_ISSOCK(st.st_mode);
+}
+
+
+fd_stream::fd_stream(const std::string &path, int flags)
+    : m_fd(::open(path.c_str(), flags | O_NONBLOCK | O_CLOEXEC)), m_owned(true) {
+    if (m_fd < 0) throw std::system_error(errno, std::generic_category(), "open " + path);
+    struct stat st;
+    m_socket = ::fstat(m_fd, &st) == 0 && S_ISSOCK(st.st_mode);
+}
+
+
+fd_stream::~fd_stream() {
+    close();
+}
+
+
+void
+fd_stream::close() noexcept {
+    if (m_fd < 0) return;
+    if (m_owned) ::close(m_fd);
+    m_fd = -1;
+}
+
+
+static bool
+wait_for(int fd, short events, int timeout_ms) {
+    pollfd p { fd, events, 0 };
+    int n;
+    do {
+        n = ::poll(&p, 1, timeout_ms);
+    } while (n < 0 && errno == EINTR);
+    if (n < 0) throw std::system_error(errno, std::generic_category(), "poll");
+    return n > 0;
+}
+
+
+bool
+fd_stream::wait_readable(int timeout_ms) const {
+    return wait_for(m_fd, POLLIN, timeout_ms);
+}
+
+
+bool
+fd_stream::wait_writable(int timeout_ms) const {
+    return wait_for(m_fd, POLLOUT, timeout_ms);
+}
+
+
+io_result
+fd_stream::read_some(void *out, std::size_t bytes) {
+    if (bytes == 0) return { 0, io_status::ok };
+    for (;;) {
+#ifdef SIO_STATS
+        ++m_syscalls;
+#endif
+        auto r = ::read(m_fd, out, bytes);
+        if (r > 0) return { static_cast<std::size_t>(r), io_status::ok };
+        if (r == 0) return { 0, io_status::eof };
+        if (errno == EAGAIN || errno == EWOULDBLOCK) return { 0, io_status::would_block };
+        if (errno == ECONNRESET) return { 0, io_status::eof };
+        if (errno != EINTR) throw std::system_error(errno, std::generic_category(), "read");
+    }
+}
+
+
+io_result
+fd_stream::write_some(const void *in, std::size_t bytes) {
+    auto data = static_cast<const char*>(in);
+    std::size_t done = 0;
+    while (done < bytes) {
+#ifdef SIO_STATS
+        ++m_syscalls;
+#endif
+        auto r = m_socket ? ::send(m_fd, data + done, bytes - done, MSG_NOSIGNAL)
+                : ::write(m_fd, data + done, bytes - done);
+        if (r >= 0) {
+            done += static_cast<std::size_t>(r);
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            return { done, io_status::would_block };
+        } else if (errno == EPIPE || errno == ECONNRESET) {
+            return { done, io_status::eof };
+        } else if (errno != EINTR) {
+            throw std::system_error(errno, std::generic_category(), "write");
+        }
+    }
+    return { done, io_status::ok };
+}
+
+
+fd_in_stream::fd_in_stream(const std::string &path)
+    : fd_stream(path, O_RDONLY) {
+#ifdef SIO_STATS
+    m_syscall_counter = syscall_counter();
+#endif
+}
+
+
+io_result
+fd_in_stream::try_get(void *out, std::size_t bytes) {
+    auto r = read_some(out, bytes);
+    m_status = r.status;
+    return r;
+}
+
+
+std::size_t
+fd_in_stream::v_get(void *out, std::size_t bytes) {
+    return try_get(out, bytes).bytes;
+}
+
+
+fd_out_stream::fd_out_stream(const std::string &path, std::size_t max_pending)
+    : fd_stream(path, O_WRONLY), m_max_pending(max_pending) {
+#ifdef SIO_STATS
+    m_syscall_counter = syscall_counter();
+#endif
+}
+
+
+fd_out_stream::~fd_out_stream() {
+    try {
+        try_flush();
+    } catch (...) {
+    }
+}
+
+
+io_status
+fd_out_stream::try_flush() {
+    if (pending() > 0) {
+        auto r = write_some(m_pending.data() + m_pending_begin, pending());
+        m_pending_begin += r.bytes;
+        if (r.status == io_status::eof) return m_status = io_status::eof;
+    }
+    if (pending() == 0) {
+        m_pending.clear();
+        m_pending_begin = 0;
+        return m_status = io_status::ok;
+    }
+    return m_status = io_status::would_block;
+}
+
+
+io_result
+fd_out_stream::try_put(const void *in, std::size_t bytes) {
+    auto data = static_cast<const char*>(in);
+    std::size_t written = 0;
+
+    // Pending bytes go first to keep the output in order
+    auto flushed = try_flush();
+    if (flushed == io_status::eof) return { 0, io_status::eof };
+    if (flushed == io_status::ok) {
+        auto r = write_some(data, bytes);
+        if (r.status == io_status::eof) {
+            m_status = io_status::eof;
+            return r;
+        }
+        written = r.bytes;
+    }
+
+    if (m_pending_begin > 0) {
+        m_pending.erase(m_pending.begin(), m_pending.begin() + static_cast<std::ptrdiff_t>(
+                m_pending_begin));
+        m_pending_begin = 0;
+    }
+    auto room = m_max_pending > m_pending.size() ? m_max_pending - m_pending.size() : 0;
+    auto kept = std::min(bytes - written, room);
+    m_pending.insert(m_pending.end(), data + written, data + written + kept);
+
+    m_status = written + kept < bytes ? io_status::would_block : io_status::ok;
+    return { written + kept, m_status };
+}
+
+
+std::size_t
+fd_out_stream::v_put(const void *in, std::size_t bytes) {
+    return try_put(in, bytes).bytes;
+}
+
+
+void
+fd_out_stream::v_flush() {
+    try_flush();
+}
+
+
+std::unique_ptr<fd_pipe>
+sio::make_pipe() {
+    int fds[2];
+    if (::pipe2(fds, O_NONBLOCK | O_CLOEXEC) != 0) {
+        throw std::system_error(errno, std::generic_category(), "pipe2");
+    }
+    return std::make_unique<fd_pipe>(fds[0], fds[1]);
+}
@@ -0,0 +1,222 @@
+#include <sio/writer/log.hh>
+#include <sio/writer/time.hh>
+#include <sio/stream/file.hh>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+using namespace sio;
+
+
+std::atomic<int> sio::detail::log_threshold { static_cast<int>(log_level::info) };
+
+
+void
+sio::set_log_level(log_level level) noexcept {
+    detail::log_threshold.store(static_cast<int>(level), std::memory_order_relaxed);
+}
+
+
+log_level
+sio::get_log_level() noexcept {
+    return static_cast<log_level>(detail::log_threshold.load(std::memory_order_relaxed));
+}
+
+
+void
+log_value::write(writeable &w) const {
+    switch (m_kind) {
+        case kind::signed_int: w << m_int; break;
+        case kind::unsigned_int: w << m_uint; break;
+        case kind::floating:
+            write_array(w, &m_float, 1, "", {}, 6, float_repr::shortest);
+            break;
+        case kind::boolean: w << (m_bool ? "true" : "false"); break;
+        case kind::string: w << as_string(); break;
+        case kind::other: m_other.write(w, m_other.value); break;
+    }
+}
+
+
+static const char *
+level_name(log_level level) {
+    auto name = enum_name(level);
+    return name ? name : "off";
+}
+
+
+// Each line is formatted into a per-thread buffer and reaches the stream in one put
+static std::string &
+line_buffer() {
+    thread_local std::string buffer;
+    buffer.clear();
+    return buffer;
+}
+
+
+static void
+put_line(std::mutex &mutex, out_stream &out, const std::string &line, log_level level) {
+    std::lock_guard<std::mutex> lock(mutex);
+    out.put(line.data(), line.size());
+    if (level >= log_level::warn) out.flush();
+}
+
+
+// Quotes s, escaping quotes, backslashes and control characters; JSON spells the latter
+// \u00XX, text lines \xXX
+static void
+write_quoted(writeable &w, string_ref s, bool json) {
+    static const char hex[] = "0123456789abcdef";
+    w << "\"";
+    auto start = s.begin(), end = s.end();
+    for (auto it = start; it != end; ++it) {
+        auto c = static_cast<unsigned char>(*it);
+        if (c >= 0x20 && c != '"' && c != '\\') continue;
+        w.write(start, static_cast<std::size_t>(it - start));
+        start = it + 1;
+        switch (c) {
+            case '"': w << "\\\""; break;
+            case '\\': w << "\\\\"; break;
+            case '\n': w << "\\n"; break;
+            case '\r': w << "\\r"; break;
+            case '\t': w << "\\t"; break;
+            default: {
+                w << (json ? "\\u00" : "\\x");
+                const char digits[] = { hex[c >> 4], hex[c & 15] };
+                w.write(digits, sizeof digits);
+            }
+        }
+    }
+    w.write(start, static_cast<std::size_t>(end - start));
+    w << "\"";
+}
+
+
+static void
+write_json_string(writeable &w, string_ref s) {
+    write_quoted(w, s, true);
+}
+
+
+// Bare if s is a single token that cannot be mistaken for a key or a separator
+static void
+write_text_string(writeable &w, string_ref s) {
+    bool bare = !s.empty() && std::none_of(s.begin(), s.end(), [](char c) {
+        auto u = static_cast<unsigned char>(c);
+        return u <= ' ' || u == '=' || u == '"';
+    });
+    if (bare) {
+        w.write(s.data(), s.size());
+    } else {
+        write_quoted(w, s, false);
+    }
+}
+
+
+static void
+write_text_value(writeable &w, const log_value &v) {
+    switch (v.type()) {
+        case log_value::kind::string:
+            write_text_string(w, v.as_string());
+            break;
+        case log_value::kind::other: {
+            std::string text;
+            ref_string_writer tw(text);
+            v.write(tw);
+            write_text_string(w, text);
+            break;
+        }
+        default:
+            v.write(w);
+    }
+}
+
+
+void
+text_log_sink::v_write(const log_record &r) {
+    auto &line = line_buffer();
+    ref_string_writer w(line);
+    if (m_timestamps) w << timestamp(r.time) << " ";
+    w << level_name(r.level) << " ";
+    write_text_string(w, r.message);
+    for (std::size_t i = 0; i < r.field_count; ++i) {
+        w << " " << r.fields[i].key << "=";
+        write_text_value(w, r.fields[i].value);
+    }
+    w << "\n";
+    put_line(m_mutex, m_out, line, r.level);
+}
+
+
+static void
+write_json_value(writeable &w, const log_value &v) {
+    switch (v.type()) {
+        case log_value::kind::signed_int:
+        case log_value::kind::unsigned_int:
+        case log_value::kind::boolean:
+            v.write(w);
+            break;
+        case log_value::kind::floating:
+            if (std::isfinite(v.as_float())) {
+                v.write(w);
+            } else {
+                w << "null";
+            }
+            break;
+        case log_value::kind::string:
+            write_json_string(w, v.as_string());
+            break;
+        case log_value::kind::other: {
+            std::string text;
+            ref_string_writer tw(text);
+            v.write(tw);
+            write_json_string(w, text);
+        }
+    }
+}
+
+
+void
+json_log_sink::v_write(const log_record &r) {
+    auto &line = line_buffer();
+    ref_string_writer w(line);
+    w << "{\"time\":" << std::chrono::duration_cast<std::chrono::nanoseconds>(
+            r.time.time_since_epoch()).count()
+      << ",\"level\":\"" << level_name(r.level) << "\",\"msg\":";
+    write_json_string(w, r.message);
+    w << ",\"file\":";
+    write_json_string(w, r.file);
+    w << ",\"line\":" << r.line;
+    for (std::size_t i = 0; i < r.field_count; ++i) {
+        w << ",";
+        write_json_string(w, r.fields[i].key);
+        w << ":";
+        write_json_value(w, r.fields[i].value);
+    }
+    w << "}\n";
+    put_line(m_mutex, m_out, line, r.level);
+}
+
+
+static text_log_sink default_sink(stderr_stream);
+static std::atomic<log_sink*> current_sink { &default_sink };
+
+
+void
+sio::set_log_sink(log_sink &sink) noexcept {
+    current_sink.store(&sink, std::memory_order_release);
+}
+
+
+log_sink &
+sio::get_log_sink() noexcept {
+    return *current_sink.load(std::memory_order_acquire);
+}
+
+
+void
+sio::detail::log_dispatch(log_level level, const char *file, unsigned line,
+        string_ref message, const log_field_ref *fields, std::size_t count) {
+    log_record r { level, std::chrono::system_clock::now(), file, line, message, fields, count };
+    get_log_sink().write(r);
+}
@@ -0,0 +1,80 @@
+#include <sio/writer/parallel.hh>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+using namespace sio;
+
+
+class task_pool::impl {
+public:
+    explicit impl(std::size_t threads) {
+        if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+        for (std::size_t i = 0; i < threads; ++i) {
+            m_threads.emplace_back([this] { run(); });
+        }
+    }
+
+    ~impl() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_wake.notify_all();
+        for (auto &t : m_threads) t.join();
+    }
+
+    std::size_t size() const noexcept {
+        return m_threads.size();
+    }
+
+    void submit(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_tasks.push_back(std::move(task));
+        }
+        m_wake.notify_one();
+    }
+
+private:
+    void run() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        for (;;) {
+            m_wake.wait(lock, [&] { return m_stop || !m_tasks.empty(); });
+            if (m_tasks.empty()) return;
+
+            auto task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+            lock.unlock();
+            task();
+            lock.lock();
+        }
+    }
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::deque<std::function<void()>> m_tasks;
+    std::vector<std::thread> m_threads;
+    bool m_stop = false;
+};
+
+
+task_pool::task_pool(std::size_t threads)
+    : m_impl(new impl(threads)) {
+}
+
+
+task_pool::~task_pool() {
+}
+
+
+std::size_t
+task_pool::size() const noexcept {
+    return m_impl->size();
+}
+
+
+void
+task_pool::submit(std::function<void()> task) {
+    m_impl->submit(std::move(task));
+}
@@ -0,0 +1,55 @@
+#include <sio/stream/peek.hh>
+#include <algorithm>
+#include <cstring>
+
+using namespace sio;
+
+
+peek_in_stream::peek_in_stream(in_stream &in, std::size_t buffer_size)
+    : m_in(in), m_buffer(std::max<std::size_t>(buffer_size, 1)) {
+}
+
+
+std::size_t
+peek_in_stream::v_get(void *out, std::size_t bytes) {
+    if (m_pos == m_end) {
+        // Large reads bypass the buffer
+        if (bytes >= m_buffer.size()) return m_in.get(out, bytes);
+        m_pos = 0;
+        m_end = m_in.get(m_buffer.data(), m_buffer.size());
+    }
+    auto n = std::min(bytes, m_end - m_pos);
+    std::memcpy(out, m_buffer.data() + m_pos, n);
+    m_pos += n;
+    return n;
+}
+
+
+string_ref
+peek_in_stream::v_peek(std::size_t bytes) {
+    if (m_end - m_pos < bytes) {
+        std::memmove(m_buffer.data(), m_buffer.data() + m_pos, m_end - m_pos);
+        m_end -= m_pos;
+        m_pos = 0;
+        if (m_buffer.size() < bytes) m_buffer.resize(bytes);
+        while (m_end < bytes) {
+            auto n = m_in.get(m_buffer.data() + m_end, m_buffer.size() - m_end);
+            if (n == 0) break;
+            m_end += n;
+        }
+    }
+    return { m_buffer.data() + m_pos, m_end - m_pos };
+}
+
+
+void
+peek_in_stream::v_consume(std::size_t bytes) {
+    auto n = std::min(bytes, m_end - m_pos);
+    m_pos += n;
+    bytes -= n;
+    while (bytes > 0) {
+        auto skipped = m_in.get(m_buffer.data(), std::min(bytes, m_buffer.size()));
+        if (skipped == 0) break;
+        bytes -= skipped;
+    }
+}
@@ -0,0 +1,271 @@
+#include <config.h>
+#include <sio/stream/prefetch.hh>
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace sio;
+
+
+class prefetch_read_stream::prefetcher {
+public:
+    // read(buf, bytes, pos) fills buf from pos and returns the byte count, 0 at the end
+    using read_fn = std::function<std::size_t(char *, std::size_t, stream_pos)>;
+    using size_fn = std::function<stream_pos()>;
+
+    prefetcher(std::size_t buffer_size, stream_pos start, read_fn read, size_fn size,
+            std::function<void()> close)
+        : m_read(std::move(read)), m_size(std::move(size)), m_close(std::move(close)),
+          m_offset(start) {
+        for (auto &b : m_buffers) b.resize(std::max<std::size_t>(buffer_size, 1));
+        m_thread = std::thread([this] { run(); });
+        request(start);
+    }
+
+    ~prefetcher() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_wake.notify_all();
+        m_thread.join();
+        if (m_close) m_close();
+    }
+
+    std::size_t get(char *out, std::size_t bytes) {
+        std::size_t done = 0;
+        while (done < bytes) {
+            if (m_cursor == m_length && !advance()) break;
+            auto n = std::min(bytes - done, m_length - m_cursor);
+            std::memcpy(out + done, current().data() + m_cursor, n);
+            m_cursor += n;
+            done += n;
+        }
+        return done;
+    }
+
+    stream_pos tell() const {
+        return m_offset + m_cursor;
+    }
+
+    stream_pos seek(stream_off offset, sio::seek rel) {
+        stream_off base = 0;
+        if (rel == sio::seek::cur) {
+            base = static_cast<stream_off>(tell());
+        } else if (rel == sio::seek::end) {
+            wait_idle();
+            base = static_cast<stream_off>(m_size());
+        }
+        auto pos = static_cast<stream_pos>(std::max<stream_off>(0, base + offset));
+
+        if (pos >= m_offset && pos <= m_offset + m_length) {
+            m_cursor = static_cast<std::size_t>(pos - m_offset);
+            return pos;
+        }
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_done.wait(lock, [&] { return !m_pending; });
+        if (m_ready && pos >= m_next_offset && pos < m_next_offset + m_next_length) {
+            lock.unlock();
+            advance();
+            m_cursor = static_cast<std::size_t>(pos - m_offset);
+            return pos;
+        }
+        lock.unlock();
+
+        // Redirect: drop both buffers and fetch around the new position
+        m_offset = pos;
+        m_length = m_cursor = 0;
+        request(pos);
+        return pos;
+    }
+
+private:
+    std::vector<char> &current() {
+        return m_buffers[m_current];
+    }
+
+    void request(stream_pos offset) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_next_offset = offset;
+            m_ready = false;
+            m_pending = true;
+            m_error = nullptr;
+        }
+        m_wake.notify_all();
+    }
+
+    void wait_idle() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_done.wait(lock, [&] { return !m_pending; });
+    }
+
+    // Makes the prefetched buffer current and starts filling the other one
+    bool advance() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (!m_pending && !m_ready) {
+            lock.unlock();
+            request(m_offset + m_length);
+            lock.lock();
+        }
+        m_done.wait(lock, [&] { return !m_pending; });
+        if (m_error) {
+            auto error = m_error;
+            m_ready = false;
+            std::rethrow_exception(error);
+        }
+
+        m_current = 1 - m_current;
+        m_offset = m_next_offset;
+        m_length = m_next_length;
+        m_cursor = 0;
+        m_ready = false;
+        lock.unlock();
+
+        request(m_offset + m_length);
+        return m_length > 0;
+    }
+
+    void run() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        for (;;) {
+            m_wake.wait(lock, [&] { return m_stop || m_pending; });
+            if (m_stop) return;
+
+            auto &buf = m_buffers[1 - m_current];
+            auto offset = m_next_offset;
+            lock.unlock();
+
+            std::size_t length = 0;
+            std::exception_ptr error;
+            try {
+                length = m_read(buf.data(), buf.size(), offset);
+            } catch (...) {
+                error = std::current_exception();
+            }
+
+            lock.lock();
+            m_next_length = length;
+            m_error = error;
+            m_ready = true;
+            m_pending = false;
+            m_done.notify_all();
+        }
+    }
+
+    read_fn m_read;
+    size_fn m_size;
+    std::function<void()> m_close;
+
+    // Owned by the caller's thread
+    std::vector<char> m_buffers[2];
+    std::size_t m_current = 0;
+    stream_pos m_offset = 0;
+    std::size_t m_length = 0;
+    std::size_t m_cursor = 0;
+
+    // Shared with the helper thread, which only touches the buffer that is not current
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+    stream_pos m_next_offset = 0;
+    std::size_t m_next_length = 0;
+    std::exception_ptr m_error;
+    bool m_pending = false;
+    bool m_ready = false;
+    bool m_stop = false;
+    std::thread m_thread;
+};
+
+
+prefetch_read_stream::prefetch_read_stream(read_stream &source, std::size_t buffer_size) {
+    auto position = std::make_shared<stream_pos>(source.tell_get());
+    auto read = [&source, position](char *buf, std::size_t bytes, stream_pos offset) {
+        if (offset != *position) source.seek_get(offset);
+        std::size_t n = 0;
+        while (n < bytes) {
+            auto got = source.get(buf + n, bytes - n);
+            if (got == 0) break;
+            n += got;
+        }
+        *position = offset + n;
+        return n;
+    };
+    auto size = [&source, position] {
+        *position = source.seek_get(0, sio::seek::end);
+        return *position;
+    };
+    m_prefetcher.reset(new prefetcher(buffer_size, *position, read, size, nullptr));
+}
+
+
+prefetch_read_stream::prefetch_read_stream(const std::string &fname, std::size_t buffer_size) {
+    int fd = ::open(fname.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) throw std::system_error(errno, std::generic_category(), "open " + fname);
+#ifdef HAVE_POSIX_FADVISE
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+    auto read = [fd](char *buf, std::size_t bytes, stream_pos offset) {
+#ifdef HAVE_POSIX_FADVISE
+        // Ask for the buffer after this one so that the disk stays busy while we copy
+        ::posix_fadvise(fd, static_cast<off_t>(offset + bytes), static_cast<off_t>(bytes),
+                POSIX_FADV_WILLNEED);
+#endif
+        std::size_t n = 0;
+        while (n < bytes) {
+            auto r = ::pread(fd, buf + n, bytes - n, static_cast<off_t>(offset + n));
+            if (r == 0) break;
+            if (r < 0) {
+                if (errno == EINTR) continue;
+                throw std::system_error(errno, std::generic_category(), "pread");
+            }
+            n += static_cast<std::size_t>(r);
+        }
+        return n;
+    };
+    auto size = [fd] {
+        struct stat st;
+        if (::fstat(fd, &st) != 0) throw std::system_error(errno, std::generic_category(), "stat");
+        return static_cast<stream_pos>(st.st_size);
+    };
+    try {
+        m_prefetcher.reset(new prefetcher(buffer_size, 0, read, size, [fd] { ::close(fd); }));
+    } catch (...) {
+        ::close(fd);
+        throw;
+    }
+}
+
+
+prefetch_read_stream::~prefetch_read_stream() {
+}
+
+
+std::size_t
+prefetch_read_stream::v_get(void *out, std::size_t bytes) {
+    return m_prefetcher->get(static_cast<char*>(out), bytes);
+}
+
+
+stream_pos
+prefetch_read_stream::v_seek_get(stream_off offset, sio::seek rel) {
+    return m_prefetcher->seek(offset, rel);
+}
+
+
+stream_pos
+prefetch_read_stream::v_tell_get() const {
+    return m_prefetcher->tell();
+}
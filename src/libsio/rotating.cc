@@ -0,0 +1,185 @@
+#include <sio/stream/rotating.hh>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <dirent.h>
+
+using namespace sio;
+
+
+// Closes finished segments and runs the archive hook so that rotation never waits for the
+// final flush of a large file
+class rotating_file_out_stream::worker {
+public:
+    explicit worker(std::function<void(const std::string &)> archive)
+        : m_archive(std::move(archive)), m_thread([this] { run(); }) {
+    }
+
+    ~worker() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_wake.notify_all();
+        m_thread.join();
+    }
+
+    void submit(std::unique_ptr<filebuf> file, std::string path) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_jobs.push_back(job { std::move(file), std::move(path) });
+        }
+        m_wake.notify_all();
+    }
+
+    void wait_idle() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_idle.wait(lock, [&] { return m_jobs.empty() && !m_busy; });
+    }
+
+private:
+    struct job {
+        std::unique_ptr<filebuf> file;
+        std::string path;
+    };
+
+    void run() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        for (;;) {
+            m_wake.wait(lock, [&] { return m_stop || !m_jobs.empty(); });
+            if (m_jobs.empty()) return;
+
+            auto j = std::move(m_jobs.front());
+            m_jobs.pop_front();
+            m_busy = true;
+            lock.unlock();
+
+            j.file->close();
+            j.file.reset();
+            if (m_archive) {
+                try {
+                    m_archive(j.path);
+                } catch (...) {
+                    // Nobody to report to; the segment simply stays unarchived
+                }
+            }
+
+            lock.lock();
+            m_busy = false;
+            m_idle.notify_all();
+        }
+    }
+
+    std::function<void(const std::string &)> m_archive;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_idle;
+    std::deque<job> m_jobs;
+    bool m_busy = false;
+    bool m_stop = false;
+    std::thread m_thread;
+};
+
+
+// Highest n among entries named base.n or base.n.<suffix> in the directory of path
+static std::uint64_t
+last_segment(const std::string &path) {
+    auto slash = path.rfind('/');
+    std::string dir = slash == std::string::npos ? "." : path.substr(0, slash + 1);
+    std::string prefix = (slash == std::string::npos ? path : path.substr(slash + 1)) + ".";
+
+    std::uint64_t last = 0;
+    if (DIR *d = ::opendir(dir.c_str())) {
+        while (auto *entry = ::readdir(d)) {
+            const char *name = entry->d_name;
+            if (std::strncmp(name, prefix.c_str(), prefix.size()) != 0) continue;
+            const char *digits = name + prefix.size();
+            char *end;
+            auto n = std::strtoull(digits, &end, 10);
+            if (end != digits && (*end == 0 || *end == '.') && n > last) last = n;
+        }
+        ::closedir(d);
+    }
+    return last;
+}
+
+
+rotating_file_out_stream::rotating_file_out_stream(std::string path, rotating_options opts)
+    : m_path(std::move(path)), m_opts(std::move(opts)),
+      m_worker(new worker(m_opts.archive)) {
+    m_segment = last_segment(m_path) + 1;
+    open();
+}
+
+
+rotating_file_out_stream::~rotating_file_out_stream() {
+    // The worker drains its queue before joining; the active segment closes here
+    m_worker.reset();
+}
+
+
+void
+rotating_file_out_stream::open() {
+    std::unique_ptr<filebuf> file(new filebuf);
+    if (!file->open(m_path, std::ios::binary | std::ios::out | std::ios::app)) {
+        throw std::system_error(errno, std::generic_category(), "open " + m_path);
+    }
+    m_size = static_cast<std::uint64_t>(file->pubseekoff(0, std::ios::end, std::ios::out));
+    m_file = std::move(file);
+    m_opened = clock::now();
+}
+
+
+void
+rotating_file_out_stream::rotate() {
+    // Renaming is a metadata update and has to happen before path can be reopened; the open
+    // file follows the rename, so closing it can wait for the worker
+    auto finished = m_path + "." + std::to_string(m_segment);
+    if (std::rename(m_path.c_str(), finished.c_str()) != 0) {
+        throw std::system_error(errno, std::generic_category(), "rename " + m_path);
+    }
+    ++m_segment;
+
+    auto old = std::move(m_file);
+    try {
+        open();
+    } catch (...) {
+        m_file = std::move(old);
+        throw;
+    }
+    m_worker->submit(std::move(old), std::move(finished));
+}
+
+
+void
+rotating_file_out_stream::wait_idle() {
+    m_worker->wait_idle();
+}
+
+
+std::size_t
+rotating_file_out_stream::v_put(const void *in, std::size_t bytes) {
+    if (m_size > 0) {
+        bool full = m_opts.max_bytes && m_size + bytes > m_opts.max_bytes;
+        bool old = m_opts.max_age.count() && clock::now() - m_opened >= m_opts.max_age;
+        if (full || old) rotate();
+    }
+
+    auto n = static_cast<std::size_t>(m_file->sputn(static_cast<const char*>(in),
+            static_cast<std::streamsize>(bytes)));
+    m_size += n;
+    return n;
+}
+
+
+void
+rotating_file_out_stream::v_flush() {
+    m_file->pubsync();
+}
@@ -5,6 +5,7 @@
 namespace sio {
 
 stream_writer<file_out_stream> out(stdout_stream);
+stream_writer<file_out_stream> log(buffered_stderr_stream);
 stream_writer<file_out_stream> err(stderr_stream);
 
 } // namespace sio
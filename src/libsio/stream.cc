@@ -1,5 +1,7 @@
 #include <sio/stream/stream.hh>
 #include <sio/stream/file.hh>
+#include <algorithm>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <memory>
@@ -7,15 +9,75 @@
 using namespace sio;
 
 
+#ifdef SIO_STATS
+
+// Estimates system calls from the filebuf operations that reach the file: buffer refills and
+// drains, seeks, and transfers large enough to bypass the buffer
+class counting_filebuf final: public std::filebuf {
+public:
+    explicit counting_filebuf(std::uint64_t &counter)
+        : m_counter(counter) {
+    }
+
+protected:
+    virtual int_type underflow() override {
+        ++m_counter;
+        return std::filebuf::underflow();
+    }
+
+    virtual int_type overflow(int_type c) override {
+        ++m_counter;
+        return std::filebuf::overflow(c);
+    }
+
+    virtual std::streamsize xsgetn(char *s, std::streamsize n) override {
+        if (n >= bypass_size) ++m_counter;
+        return std::filebuf::xsgetn(s, n);
+    }
+
+    virtual std::streamsize xsputn(const char *s, std::streamsize n) override {
+        if (n >= bypass_size) ++m_counter;
+        return std::filebuf::xsputn(s, n);
+    }
+
+    virtual int sync() override {
+        if (pptr() != pbase()) ++m_counter;
+        return std::filebuf::sync();
+    }
+
+    virtual pos_type seekoff(off_type off, std::ios::seekdir dir,
+            std::ios::openmode which) override {
+        ++m_counter;
+        return std::filebuf::seekoff(off, dir, which);
+    }
+
+    virtual pos_type seekpos(pos_type pos, std::ios::openmode which) override {
+        ++m_counter;
+        return std::filebuf::seekpos(pos, which);
+    }
+
+private:
+    enum : std::streamsize { bypass_size = 1024 };
+
+    std::uint64_t &m_counter;
+};
+
+#endif
+
+
 file_stream::file_stream(const std::string &name, int perm, open_mode mode)
     : m_owns_streambuf(true) {
     std::ios::openmode ios_mode = std::ios::binary;
     if (perm & allow_get) ios_mode |= std::ios::in;
     if ((perm & allow_put) || mode == open_mode::overwrite) ios_mode |= std::ios::out;
     if (mode == open_mode::append) ios_mode |= std::ios::app;
-    if (mode == open_mode::truncate) ios_mode |= std::ios::trunc;
+    if (mode == open_mode::truncate && (perm & allow_put)) ios_mode |= std::ios::trunc;
 
+#ifdef SIO_STATS
+    std::unique_ptr<std::filebuf> buf(new counting_filebuf(m_syscalls));
+#else
     std::unique_ptr<std::filebuf> buf(new std::filebuf);
+#endif
     if (buf->open(name, ios_mode)) {
         m_streambuf = buf.release();
     } else {
@@ -31,23 +93,103 @@ file_stream::~file_stream() {
 }
 
 
+namespace {
+
+// Reaches the protected get area of any streambuf through pointers to members, which a derived
+// class may form
+struct get_area: std::streambuf {
+    static string_ref of(std::streambuf &b) {
+        auto begin = (b.*&get_area::gptr)();
+        return { begin, static_cast<std::size_t>((b.*&get_area::egptr)() - begin) };
+    }
+
+    static void bump(std::streambuf &b, std::size_t n) {
+        (b.*&get_area::gbump)(static_cast<int>(n));
+    }
+};
+
+} // namespace
+
+
 std::size_t
 file_in_stream::v_get(void *out, std::size_t bytes) {
-    return static_cast<std::size_t>(streambuf().sgetn(
-            static_cast<char*>(out), static_cast<std::streamsize>(bytes)));
+    return get_inline(out, bytes);
+}
+
+
+string_ref
+file_in_stream::v_peek(std::size_t bytes) {
+    if (m_peeked_pos < m_peeked_end) return peek_spanning(bytes);
+
+    auto &buf = streambuf();
+    auto area = get_area::of(buf);
+    if (area.empty() && bytes > 0) {
+        if (buf.sgetc() == std::streambuf::traits_type::eof()) return {};
+        area = get_area::of(buf);
+    }
+    return area.size() >= bytes ? area : peek_spanning(bytes);
+}
+
+
+string_ref
+file_in_stream::peek_spanning(std::size_t bytes) {
+    auto &buf = streambuf();
+    auto pending = m_peeked_end - m_peeked_pos;
+    if (pending > 0) {
+        // Not seekable; the unread side buffer is topped up from the streambuf
+        std::memmove(m_peeked.data(), m_peeked.data() + m_peeked_pos, pending);
+        m_peeked_pos = 0;
+        m_peeked_end = pending;
+        if (pending < bytes) {
+            m_peeked.resize(std::max(m_peeked.size(), bytes));
+            m_peeked_end += static_cast<std::size_t>(buf.sgetn(m_peeked.data() + pending,
+                    static_cast<std::streamsize>(bytes - pending)));
+        }
+        return { m_peeked.data(), m_peeked_end };
+    }
+
+    auto pos = buf.pubseekoff(0, std::ios::cur, std::ios::in);
+    m_peeked.resize(std::max(m_peeked.size(), bytes));
+    auto n = static_cast<std::size_t>(buf.sgetn(m_peeked.data(),
+            static_cast<std::streamsize>(bytes)));
+    if (pos == std::streambuf::pos_type(-1) || buf.pubseekpos(pos, std::ios::in) != pos) {
+        m_peeked_pos = 0;
+        m_peeked_end = n;
+    }
+    return { m_peeked.data(), n };
+}
+
+
+void
+file_in_stream::v_consume(std::size_t bytes) {
+    auto taken = std::min(bytes, m_peeked_end - m_peeked_pos);
+    m_peeked_pos += taken;
+    bytes -= taken;
+
+    auto &buf = streambuf();
+    while (bytes > 0) {
+        auto avail = std::min(bytes, get_area::of(buf).size());
+        if (avail > 0) {
+            get_area::bump(buf, avail);
+            bytes -= avail;
+        } else if (buf.sbumpc() == std::streambuf::traits_type::eof()) {
+            break;
+        } else {
+            --bytes;
+        }
+    }
 }
 
 
 std::size_t
 file_out_stream::v_put(const void *in, std::size_t bytes) {
-    return static_cast<std::size_t>(streambuf().sputn(
-            static_cast<const char*>(in), static_cast<std::streamsize>(bytes)));
+    return put_inline(in, bytes);
 }
 
 
 void
 file_out_stream::v_flush() {
-    streambuf().pubsync();
+    flush_inline();
 }
 
 
@@ -94,6 +236,9 @@ file_write_stream::v_tell_put() const {
 
 stream_pos
 file_rw_stream::seek(stream_off offset, sio::seek rel) {
+#ifdef SIO_STATS
+    ++m_stats.seeks;
+#endif
     return seek_streambuf(streambuf(), offset, rel, std::ios::in | std::ios::out);
 }
 
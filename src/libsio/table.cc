@@ -0,0 +1,62 @@
+#include <sio/writer/table.hh>
+#include <algorithm>
+
+using namespace sio;
+
+
+table_writer::table_writer(writeable &w, std::vector<column> columns, char separator,
+        char quote)
+    : m_target(&w), m_columns(std::move(columns)), m_separator(separator), m_quote(quote),
+      m_specials { separator, quote, '\r', '\n', 0 } {
+    m_buffer.target = &w;
+}
+
+
+std::size_t
+table_writer::begin_field(std::size_t index) {
+    if (index > 0) {
+        m_buffer.data.push_back(m_separator);
+    }
+    m_buffer.col = index < m_columns.size() ? &m_columns[index] : &m_default_column;
+    return m_buffer.data.size();
+}
+
+
+void
+table_writer::end_field(std::size_t start) {
+    auto &data = m_buffer.data;
+    auto &col = *m_buffer.col;
+
+    bool quote = col.quoting == quoting::all || (col.quoting == quoting::minimal
+            && data.find_first_of(m_specials, start, 4) != std::string::npos);
+    if (quote) {
+        // Escape the whole field in place, back to front, doubling embedded quotes
+        auto end = data.size();
+        auto n_quotes = static_cast<std::size_t>(std::count(
+                data.begin() + static_cast<std::ptrdiff_t>(start), data.end(), m_quote));
+        data.resize(end + n_quotes + 2);
+        auto dst = data.size();
+        data[--dst] = m_quote;
+        while (end > start) {
+            char c = data[--end];
+            data[--dst] = c;
+            if (c == m_quote) {
+                data[--dst] = c;
+            }
+        }
+        data[--dst] = m_quote;
+    }
+
+    auto len = data.size() - start;
+    if (len < col.width) {
+        auto pad = col.width - len;
+        if (col.flags & fmt::left) {
+            data.append(pad, ' ');
+        } else if (col.flags & fmt::center) {
+            data.insert(start, pad / 2, ' ');
+            data.append(pad - pad / 2, ' ');
+        } else {
+            data.insert(start, pad, ' ');
+        }
+    }
+}
@@ -0,0 +1,238 @@
+#include <sio/writer/time.hh>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <memory>
+
+using namespace sio;
+
+
+static char *
+append_uint(char *p, unsigned long long v, unsigned min_digits) {
+    char digits[20];
+    unsigned n = 0;
+    do {
+        digits[n++] = static_cast<char>('0' + v % 10);
+        v /= 10;
+    } while (v > 0);
+    while (n < min_digits) digits[n++] = '0';
+    while (n > 0) *p++ = digits[--n];
+    return p;
+}
+
+
+time_formatter::time_formatter(const std::string &layout, time_zone zone)
+    : m_zone(zone) {
+    auto literal = [&](const char *s, std::size_t n) {
+        if (m_fields.empty() || m_fields.back().spec) m_fields.push_back({ 0, false, 0, {} });
+        m_fields.back().literal.append(s, n);
+    };
+    for (std::size_t i = 0; i < layout.size(); ++i) {
+        if (layout[i] != '%' || i + 1 == layout.size()) {
+            literal(&layout[i], 1);
+            continue;
+        }
+        char c = layout[++i];
+        if (c == '%') {
+            literal("%", 1);
+        } else if (c >= '1' && c <= '9' && i + 1 < layout.size() && layout[i + 1] == 'f') {
+            m_fields.push_back({ 'f', false, static_cast<unsigned>(c - '0'), {} });
+            ++i;
+        } else if (c == ':' && i + 1 < layout.size() && layout[i + 1] == 'z') {
+            m_fields.push_back({ 'z', true, 0, {} });
+            ++i;
+        } else if (std::strchr("YmdHMSabzf", c)) {
+            m_fields.push_back({ c, false, c == 'f' ? 6u : 0u, {} });
+        } else {
+            literal(&layout[i - 1], 2);
+        }
+    }
+}
+
+
+std::string
+time_formatter::iso8601_layout(unsigned digits, time_zone zone) {
+    std::string layout = "%Y-%m-%dT%H:%M:%S";
+    if (digits > 0) {
+        layout += ".%";
+        layout += static_cast<char>('0' + (digits > 9 ? 9 : digits));
+        layout += "f";
+    }
+    layout += zone == time_zone::utc ? "Z" : "%:z";
+    return layout;
+}
+
+
+void
+time_formatter::refresh(long long second) {
+    static const char weekdays[][4] = { "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat" };
+    static const char months[][4] = { "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug",
+            "Sep", "Oct", "Nov", "Dec" };
+
+    auto t = static_cast<std::time_t>(second);
+    std::tm tm {};
+    if (m_zone == time_zone::utc) {
+        ::gmtime_r(&t, &tm);
+    } else {
+        ::localtime_r(&t, &tm);
+    }
+    long offset = m_zone == time_zone::utc ? 0 : tm.tm_gmtoff;
+
+    m_cached.clear();
+    m_fractions.clear();
+    char buf[32];
+    for (auto &f : m_fields) {
+        char *p = buf;
+        switch (f.spec) {
+            case 0: m_cached += f.literal; break;
+            case 'Y': {
+                int year = tm.tm_year + 1900;
+                if (year < 0) *p++ = '-';
+                p = append_uint(p, static_cast<unsigned>(std::abs(year)), 4);
+                break;
+            }
+            case 'm': p = append_uint(p, static_cast<unsigned>(tm.tm_mon + 1), 2); break;
+            case 'd': p = append_uint(p, static_cast<unsigned>(tm.tm_mday), 2); break;
+            case 'H': p = append_uint(p, static_cast<unsigned>(tm.tm_hour), 2); break;
+            case 'M': p = append_uint(p, static_cast<unsigned>(tm.tm_min), 2); break;
+            case 'S': p = append_uint(p, static_cast<unsigned>(tm.tm_sec), 2); break;
+            case 'a': m_cached += weekdays[tm.tm_wday % 7]; break;
+            case 'b': m_cached += months[tm.tm_mon % 12]; break;
+            case 'z': {
+                *p++ = offset < 0 ? '-' : '+';
+                auto minutes = static_cast<unsigned long long>(std::labs(offset) / 60);
+                p = append_uint(p, minutes / 60, 2);
+                if (f.colon) *p++ = ':';
+                p = append_uint(p, minutes % 60, 2);
+                break;
+            }
+            case 'f': m_fractions.push_back({ m_cached.size(), f.digits }); break;
+        }
+        m_cached.append(buf, static_cast<std::size_t>(p - buf));
+    }
+    m_second = second;
+}
+
+
+void
+time_formatter::write_ns(writeable &w, long long ns) {
+    long long second = ns / 1000000000, nanos = ns % 1000000000;
+    if (nanos < 0) {
+        nanos += 1000000000;
+        --second;
+    }
+    if (second != m_second) refresh(second);
+    if (m_fractions.empty()) {
+        w.write(m_cached.data(), m_cached.size());
+        return;
+    }
+
+    char digits[9];
+    append_uint(digits, static_cast<unsigned long long>(nanos), 9);
+
+    // The whole timestamp goes out in one write unless the layout is unusually long
+    char buf[256];
+    std::size_t len = 0, pos = 0;
+    auto emit = [&](const char *s, std::size_t n) {
+        if (len + n > sizeof buf) {
+            w.write(buf, len);
+            len = 0;
+        }
+        if (n > sizeof buf) {
+            w.write(s, n);
+        } else {
+            std::memcpy(buf + len, s, n);
+            len += n;
+        }
+    };
+    for (auto &f : m_fractions) {
+        emit(m_cached.data() + pos, f.offset - pos);
+        emit(digits, f.digits);
+        pos = f.offset;
+    }
+    emit(m_cached.data() + pos, m_cached.size() - pos);
+    w.write(buf, len);
+}
+
+
+time_formatter &
+detail::iso8601_formatter(unsigned digits, time_zone zone) {
+    thread_local std::unique_ptr<time_formatter> formatters[2][10];
+    auto &f = formatters[zone == time_zone::local][digits];
+    if (!f) {
+        f = std::make_unique<time_formatter>(time_formatter::iso8601_layout(digits, zone), zone);
+    }
+    return *f;
+}
+
+
+// Writes the digits of a fraction of scale, dropping trailing zeros, or nothing if all are zero
+static char *
+append_fraction(char *p, unsigned long long rem, unsigned long long scale, unsigned digits) {
+    unsigned long long divisor = scale;
+    for (unsigned i = 0; i < digits; ++i) divisor /= 10;
+    if (divisor == 0) divisor = 1;
+    auto frac = rem / divisor;
+    while (digits > 0 && frac % 10 == 0) {
+        frac /= 10;
+        --digits;
+    }
+    if (digits == 0) return p;
+    *p++ = '.';
+    return append_uint(p, frac, digits);
+}
+
+
+void
+detail::write_duration(writeable &w, long long ns, unsigned precision) {
+    auto abs = ns < 0 ? 0ull - static_cast<unsigned long long>(ns)
+            : static_cast<unsigned long long>(ns);
+    unsigned long long scale;
+    unsigned scale_digits;
+    const char *unit;
+    if (abs >= 1000000000) {
+        scale = 1000000000, scale_digits = 9, unit = "s";
+    } else if (abs >= 1000000) {
+        scale = 1000000, scale_digits = 6, unit = "ms";
+    } else if (abs >= 1000) {
+        scale = 1000, scale_digits = 3, unit = "us";
+    } else {
+        scale = 1, scale_digits = 0, unit = "ns";
+    }
+
+    char buf[48], *p = buf;
+    if (ns < 0) *p++ = '-';
+    p = append_uint(p, abs / scale, 1);
+    p = append_fraction(p, abs % scale, scale, std::min(precision, scale_digits));
+    auto unit_len = std::strlen(unit);
+    std::memcpy(p, unit, unit_len);
+    w.write(buf, static_cast<std::size_t>(p - buf) + unit_len);
+}
+
+
+void
+detail::write_iso8601_duration(writeable &w, long long ns) {
+    auto abs = ns < 0 ? 0ull - static_cast<unsigned long long>(ns)
+            : static_cast<unsigned long long>(ns);
+    const unsigned long long second = 1000000000, minute = 60 * second, hour = 60 * minute;
+
+    char buf[64], *p = buf;
+    if (ns < 0) *p++ = '-';
+    *p++ = 'P';
+    *p++ = 'T';
+    if (abs >= hour) {
+        p = append_uint(p, abs / hour, 1);
+        *p++ = 'H';
+    }
+    if (abs % hour >= minute) {
+        p = append_uint(p, abs % hour / minute, 1);
+        *p++ = 'M';
+    }
+    if (abs % minute != 0 || abs == 0) {
+        p = append_uint(p, abs % minute / second, 1);
+        p = append_fraction(p, abs % second, second, 9);
+        *p++ = 'S';
+    }
+    w.write(buf, static_cast<std::size_t>(p - buf));
+}
@@ -1,6 +1,18 @@
 #include <sio/writer/writer.hh>
 #include <locale>
-#include <streambuf>
+#include <limits>
+#include <climits>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#if __cplusplus >= 201703L && defined(__has_include)
+#if __has_include(<charconv>)
+#include <charconv>
+#endif
+#endif
 
 using namespace sio;
 
@@ -13,66 +25,24 @@ ret_t sio::ret;
 discarding_writer sio::nirvana;
 
 
-writeable::ios_cache::ref_set::~ref_set() {}
-
-
-class dummy_ostreambuf final: public std::streambuf {
-public:
-    void use(char *buffer, std::size_t size) {
-        setp(buffer, buffer+size);
-    }
-
-    std::size_t pos() const {
-        return static_cast<std::size_t>(pptr() - pbase());
-    }
-};
-
-
-class dummy_ios final: public std::ios_base {};
-
-
 void
 writer::ios_cache::create_refs() {
     m_refs = std::make_unique<ref_set>();
 }
 
 void
-writer::ios_cache::create_ios_base() {
-    refs().ios_base = std::make_unique<dummy_ios>();
-}
-
-void
-writer::ios_cache::create_streambuf() {
-    refs().streambuf = std::make_unique<dummy_ostreambuf>();
-}
-
-
-
-template<typename Facet>
-const Facet &
-writer::ios_cache::cached_facet(Facet *&ptr, const std::locale &locale) {
-    if (!ptr) {
-        ptr = &std::use_facet<Facet>(locale);
+writer::ios_cache::load_numpunct(ref_set &r) {
+    auto &facet = std::use_facet<std::numpunct<char>>(*r.locale);
+    r.numpunct.decimal_point = facet.decimal_point();
+    r.numpunct.thousands_sep = facet.thousands_sep();
+    r.numpunct.grouping = facet.grouping();
+    auto &grouping = r.numpunct.grouping;
+    if (!grouping.empty() && (grouping[0] <= 0 || grouping[0] == CHAR_MAX)) {
+        grouping.clear();
     }
-    return *ptr;
-}
-
-
-namespace sio {
-
-template<>
-inline const std::num_put<char> &
-writer::ios_cache::locale_facet<std::num_put<char>>(const std::locale &locale) {
-    auto &r = refs(locale);
-    return cached_facet(r.num_put, *r.locale);
+    r.numpunct_valid = true;
 }
 
-} // namespace sio
-
-
-template const std::num_put<char> &
-writer::ios_cache::locale_facet<std::num_put<char>>(const std::locale &);
-
 
 const std::locale &
 writeable::v_locale() const {
@@ -99,48 +69,161 @@ static auto widen_integer(const Number &num) {
 }
 
 
-template<typename Number, std::enable_if_t<std::is_arithmetic<Number>{}
-        || std::is_same<Number, bool>{} || std::is_same<Number, const void*>{}, int>>
-void
-sio::write(writeable &w, const Number &v, bitfield<fmt> flags, unsigned precision) {
-    std::ios_base::fmtflags iosflags {};
-    if (flags & fmt::oct) {
-        iosflags |= std::ios_base::oct;
-    } else if (flags & fmt::hex) {
-        iosflags |= std::ios_base::hex;
-    } else {
-        iosflags |= std::ios_base::dec;
+static const writer::ios_cache::numpunct_data classic_numpunct { '.', ',', {} };
+
+
+// The classic locale is answered without touching the ios cache, which would allocate
+static const writer::ios_cache::numpunct_data &
+numpunct(writeable &w) {
+    auto &locale = w.locale();
+    if (&locale == &std::locale::classic()) {
+        return classic_numpunct;
     }
-    if (flags & fmt::sci) {
-        iosflags |= std::ios_base::scientific;
-    } else if (flags & fmt::fixed) {
-        iosflags |= std::ios_base::fixed;
+    return w.ios().numpunct(locale);
+}
+
+
+class digit_grouper {
+public:
+    explicit digit_grouper(const writer::ios_cache::numpunct_data &punct) noexcept
+        : m_grouping(punct.grouping), m_sep(punct.thousands_sep),
+          m_size(m_grouping.empty() ? 0 : m_grouping[0]) {
     }
-    if (flags & fmt::show_base) {
-        iosflags |= std::ios_base::showbase;
+
+    // Called before each digit is prepended, right to left
+    void prepend_separator(char *&p) noexcept {
+        if (m_size > 0 && m_digits == m_size) {
+            *--p = m_sep;
+            m_digits = 0;
+            if (m_index + 1 < m_grouping.size()) {
+                auto next = m_grouping[++m_index];
+                m_size = next > 0 && next != CHAR_MAX ? next : 0;
+            }
+        }
+        ++m_digits;
     }
-    if (flags & fmt::show_point) {
-        iosflags |= std::ios_base::showpoint;
+
+private:
+    const std::string &m_grouping;
+    char m_sep;
+    int m_size;
+    int m_digits = 0;
+    std::size_t m_index = 0;
+};
+
+
+template<typename Integer, std::enable_if_t<std::is_integral<Integer>{}, int> = 0>
+static void
+write_number(writeable &w, Integer v, bitfield<fmt> flags, unsigned) {
+    using unsigned_type = std::make_unsigned_t<Integer>;
+
+    unsigned base = flags & fmt::oct ? 8 : flags & fmt::hex ? 16 : 10;
+    bool negative = base == 10 && std::is_signed<Integer>{} && v < Integer{};
+    auto u = static_cast<unsigned_type>(v);
+    if (negative) u = static_cast<unsigned_type>(0 - u);
+
+    const char *digits = flags & fmt::uppercase ? "0123456789ABCDEF" : "0123456789abcdef";
+    digit_grouper grouper(numpunct(w));
+    char raw[2 * std::numeric_limits<unsigned_type>::digits + 4];
+    char *end = raw + sizeof raw, *p = end;
+    do {
+        grouper.prepend_separator(p);
+        *--p = digits[u % base];
+        u = static_cast<unsigned_type>(u / base);
+    } while (u);
+
+    if (base == 10) {
+        if (negative) {
+            *--p = '-';
+        } else if (std::is_signed<Integer>{} && (flags & fmt::show_sign)) {
+            *--p = '+';
+        }
+    } else if ((flags & fmt::show_base) && v) {
+        if (base == 16) {
+            *--p = flags & fmt::uppercase ? 'X' : 'x';
+        }
+        *--p = '0';
     }
-    if (flags & fmt::show_sign) {
-        iosflags |= std::ios_base::showpos;
+    w.write(p, static_cast<std::size_t>(end - p));
+}
+
+
+template<typename Float, std::enable_if_t<std::is_floating_point<Float>{}, int> = 0>
+static void
+write_number(writeable &w, Float v, bitfield<fmt> flags, unsigned precision) {
+    bool upper = flags & fmt::uppercase;
+    char format[10], *f = format;
+    *f++ = '%';
+    if (flags & fmt::show_sign) *f++ = '+';
+    if (flags & fmt::show_point) *f++ = '#';
+    *f++ = '.';
+    *f++ = '*';
+    if (std::is_same<Float, long double>{}) *f++ = 'L';
+    *f++ = flags & fmt::sci ? (upper ? 'E' : 'e') : flags & fmt::fixed ? (upper ? 'F' : 'f')
+            : (upper ? 'G' : 'g');
+    *f = 0;
+
+    auto prec = static_cast<int>(precision);
+    char small[64];
+    std::unique_ptr<char[]> large;
+    char *str = small;
+    auto len = static_cast<std::size_t>(std::snprintf(small, sizeof small, format, prec, v));
+    if (len >= sizeof small) {
+        large.reset(new char[len + 1]);
+        str = large.get();
+        std::snprintf(str, len + 1, format, prec, v);
     }
-    if (flags & fmt::uppercase) {
-        iosflags |= std::ios_base::uppercase;
+
+    auto &punct = numpunct(w);
+    std::size_t int_begin = str[0] == '+' || str[0] == '-' ? 1 : 0, int_end = int_begin;
+    while (str[int_end] >= '0' && str[int_end] <= '9') ++int_end;
+    // The C library decimal point is whatever follows the integer digits that is not part of
+    // an exponent, hex prefix or inf/nan
+    bool has_point = int_end < len && !(str[int_end] >= 'a' && str[int_end] <= 'z')
+            && !(str[int_end] >= 'A' && str[int_end] <= 'Z');
+    if (has_point) {
+        str[int_end] = punct.decimal_point;
     }
 
-    auto &ios = w.ios().ios_base();
-    ios.flags(iosflags);
-    ios.precision(precision);
-    //ios.width(0);
+    if (punct.grouping.empty() || !(has_point || int_end == len)
+            || int_end - int_begin <= static_cast<std::size_t>(punct.grouping[0])) {
+        w.write(str, len);
+        return;
+    }
+
+    char grouped_small[2 * sizeof small];
+    std::unique_ptr<char[]> grouped_large;
+    char *grouped = grouped_small;
+    if (2 * len > sizeof grouped_small) {
+        grouped_large.reset(new char[2 * len]);
+        grouped = grouped_large.get();
+    }
+    char *end = grouped + 2 * len, *p = end - (len - int_end);
+    std::copy(str + int_end, str + len, p);
+    digit_grouper grouper(punct);
+    for (auto i = int_end; i > int_begin; --i) {
+        grouper.prepend_separator(p);
+        *--p = str[i - 1];
+    }
+    if (int_begin) {
+        *--p = str[0];
+    }
+    w.write(p, static_cast<std::size_t>(end - p));
+}
+
 
-    auto &fac = w.ios().template locale_facet<std::num_put<char>>(w.locale());
-    auto &buf = static_cast<dummy_ostreambuf&>(w.ios().streambuf());
-    char raw[20];
-    buf.use(raw, 20);
-    std::ostreambuf_iterator<char> start(&buf);
-    fac.put(std::ostreambuf_iterator<char>(&buf), ios, 0, widen_integer(v));
-    w.write(raw, buf.pos());
+static void
+write_number(writeable &w, const void *v, bitfield<fmt> flags, unsigned precision) {
+    write_number(w, reinterpret_cast<std::uintptr_t>(v),
+            (flags & ~fmt::base_mask) | fmt::hex | fmt::show_base, precision);
+}
+
+
+template<typename Number, std::enable_if_t<std::is_arithmetic<Number>{}
+        || std::is_same<Number, bool>{} || std::is_same<Number, const void*>{}, int>>
+void
+sio::write(writeable &w, const Number &v, bitfield<fmt> flags, unsigned precision) {
+    write_number(w, widen_integer(v), flags, precision);
 }
 
 template void sio::write(writeable &, const char &, bitfield<fmt>, unsigned);
@@ -161,6 +244,231 @@ template void sio::write(writeable &, const void *const &, bitfield<fmt>, unsign
 template void sio::write(writeable &, const bool &, bitfield<fmt>, unsigned);
 
 
+// Collects array output so that the target sees one write per batch instead of one per token
+class batch_writer final: public writer {
+public:
+    enum : std::size_t { capacity = 4096, max_token = 128 };
+
+    explicit batch_writer(writeable &target) noexcept
+        : m_target(target) {
+    }
+
+    // Room for at least max_token bytes
+    char *reserve() {
+        if (m_size + max_token > capacity) flush();
+        return m_buf + m_size;
+    }
+
+    void commit(char *end) noexcept {
+        m_size = static_cast<std::size_t>(end - m_buf);
+    }
+
+    void append(const char *seq, std::size_t n) {
+        if (m_size + n > capacity) {
+            flush();
+            if (n > capacity) {
+                m_target.write(seq, n);
+                return;
+            }
+        }
+        std::memcpy(m_buf + m_size, seq, n);
+        m_size += n;
+    }
+
+    void flush() {
+        if (m_size) m_target.write(m_buf, m_size);
+        m_size = 0;
+    }
+
+protected:
+    virtual void v_write(const char *seq, std::size_t n) override {
+        append(seq, n);
+    }
+
+    virtual const std::locale &v_locale() const override {
+        return m_target.locale();
+    }
+
+private:
+    writeable &m_target;
+    std::size_t m_size = 0;
+    char m_buf[capacity];
+};
+
+
+static const char digit_pairs[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+
+// Decimal digits two at a time, right to left from end
+template<typename Unsigned>
+static char *
+format_decimal(char *end, Unsigned u) noexcept {
+    while (u >= 100) {
+        auto i = static_cast<std::size_t>(u % 100) * 2;
+        u = static_cast<Unsigned>(u / 100);
+        *--end = digit_pairs[i + 1];
+        *--end = digit_pairs[i];
+    }
+    if (u >= 10) {
+        auto i = static_cast<std::size_t>(u) * 2;
+        *--end = digit_pairs[i + 1];
+        *--end = digit_pairs[i];
+    } else {
+        *--end = static_cast<char>('0' + u);
+    }
+    return end;
+}
+
+
+template<typename Integer, std::enable_if_t<std::is_integral<Integer>{}, int> = 0>
+static bool
+fast_array_element(batch_writer &b, Integer v, bitfield<fmt> flags, unsigned, float_repr,
+        const writer::ios_cache::numpunct_data &punct) {
+    if ((flags & (fmt::oct | fmt::hex)) || !punct.grouping.empty()) return false;
+
+    using unsigned_type = std::make_unsigned_t<Integer>;
+    auto u = static_cast<unsigned_type>(v);
+    bool negative = std::is_signed<Integer>{} && v < Integer{};
+    if (negative) u = static_cast<unsigned_type>(0 - u);
+
+    char digits[std::numeric_limits<unsigned_type>::digits10 + 2];
+    char *end = digits + sizeof digits;
+    char *p = format_decimal(end, u);
+    char *out = b.reserve();
+    if (negative) {
+        *out++ = '-';
+    } else if (std::is_signed<Integer>{} && (flags & fmt::show_sign)) {
+        *out++ = '+';
+    }
+    std::memcpy(out, p, static_cast<std::size_t>(end - p));
+    b.commit(out + (end - p));
+    return true;
+}
+
+
+#if defined(__cpp_lib_to_chars)
+
+template<typename Float>
+static char *
+format_float(char *first, char *last, Float v, bitfield<fmt> flags, unsigned precision,
+        float_repr repr) {
+    if (repr == float_repr::shortest) {
+        return std::to_chars(first, last, v).ptr;
+    }
+    auto format = flags & fmt::sci ? std::chars_format::scientific
+            : flags & fmt::fixed ? std::chars_format::fixed : std::chars_format::general;
+    auto result = std::to_chars(first, last, v, format, static_cast<int>(precision));
+    return result.ec == std::errc() ? result.ptr : nullptr;
+}
+
+#else
+
+template<typename Float>
+static char *
+format_float(char *first, char *last, Float v, bitfield<fmt>, unsigned, float_repr repr) {
+    if (repr != float_repr::shortest) return nullptr;
+
+    // Without to_chars, the shortest form is the first precision that reads back exactly
+    const char *format = std::is_same<Float, long double>{} ? "%.*Lg" : "%.*g";
+    for (int prec = 1; prec <= std::numeric_limits<Float>::max_digits10; ++prec) {
+        auto n = std::snprintf(first, static_cast<std::size_t>(last - first), format, prec, v);
+        if (n < 0 || n >= last - first) return nullptr;
+        if (static_cast<Float>(std::strtold(first, nullptr)) == v || v != v) {
+            return first + n;
+        }
+    }
+    return nullptr;
+}
+
+#endif
+
+
+template<typename Float>
+static bool
+fast_float_element(batch_writer &b, Float v, bitfield<fmt> flags, unsigned precision,
+        float_repr repr, const writer::ios_cache::numpunct_data &punct) {
+    if ((flags & (fmt::show_point | fmt::uppercase)) || !punct.grouping.empty()) return false;
+
+    char *out = b.reserve();
+    char *first = out;
+    if ((flags & fmt::show_sign) && !std::signbit(v)) *first++ = '+';
+    char *end = format_float(first, out + batch_writer::max_token, v, flags, precision, repr);
+    if (!end) return false;
+
+    if (punct.decimal_point != '.') {
+        std::replace(first, end, '.', punct.decimal_point);
+    }
+    b.commit(end);
+    return true;
+}
+
+
+template<typename Float, std::enable_if_t<std::is_floating_point<Float>{}, int> = 0>
+static bool
+fast_array_element(batch_writer &b, Float v, bitfield<fmt> flags, unsigned precision,
+        float_repr repr, const writer::ios_cache::numpunct_data &punct) {
+    return fast_float_element(b, v, flags, precision, repr, punct);
+}
+
+
+static bool
+fast_array_element(batch_writer &, bool, bitfield<fmt>, unsigned, float_repr,
+        const writer::ios_cache::numpunct_data &) {
+    return false;
+}
+
+
+template<typename Number, std::enable_if_t<std::is_arithmetic<Number>{}, int>>
+void
+sio::write_array(writeable &w, const Number *data, std::size_t size, const char *separator,
+        bitfield<fmt> flags, unsigned precision, float_repr repr) {
+    batch_writer b(w);
+    auto &punct = numpunct(w);
+    auto sep_length = std::strlen(separator);
+    for (std::size_t i = 0; i < size; ++i) {
+        if (i) b.append(separator, sep_length);
+        if (!fast_array_element(b, data[i], flags, precision, repr, punct)) {
+            write_number(b, widen_integer(data[i]), flags, precision);
+        }
+    }
+    b.flush();
+}
+
+template void sio::write_array(writeable &, const char *, std::size_t, const char *,
+        bitfield<fmt>, unsigned, float_repr);
+template void sio::write_array(writeable &, const unsigned char *, std::size_t, const char *,
+        bitfield<fmt>, unsigned, float_repr);
+template void sio::write_array(writeable &, const signed char *, std::size_t, const char *,
+        bitfield<fmt>, unsigned, float_repr);
+template void sio::write_array(writeable &, const unsigned short *, std::size_t, const char *,
+        bitfield<fmt>, unsigned, float_repr);
+template void sio::write_array(writeable &, const short *, std::size_t, const char *,
+        bitfield<fmt>, unsigned, float_repr);
+template void sio::write_array(writeable &, const unsigned int *, std::size_t, const char *,
+        bitfield<fmt>, unsigned, float_repr);
+template void sio::write_array(writeable &, const int *, std::size_t, const char *,
+        bitfield<fmt>, unsigned, float_repr);
+template void sio::write_array(writeable &, const unsigned long *, std::size_t, const char *,
+        bitfield<fmt>, unsigned, float_repr);
+template void sio::write_array(writeable &, const long *, std::size_t, const char *,
+        bitfield<fmt>, unsigned, float_repr);
+template void sio::write_array(writeable &, const unsigned long long *, std::size_t,
+        const char *, bitfield<fmt>, unsigned, float_repr);
+template void sio::write_array(writeable &, const long long *, std::size_t, const char *,
+        bitfield<fmt>, unsigned, float_repr);
+template void sio::write_array(writeable &, const float *, std::size_t, const char *,
+        bitfield<fmt>, unsigned, float_repr);
+template void sio::write_array(writeable &, const double *, std::size_t, const char *,
+        bitfield<fmt>, unsigned, float_repr);
+template void sio::write_array(writeable &, const long double *, std::size_t, const char *,
+        bitfield<fmt>, unsigned, float_repr);
+template void sio::write_array(writeable &, const bool *, std::size_t, const char *,
+        bitfield<fmt>, unsigned, float_repr);
+
+
 add_flag_format_mod_tag<fmt::oct> sio::oct;
 add_flag_format_mod_tag<fmt::hex> sio::hex;
 add_flag_format_mod_tag<fmt::sci> sio::sci;
@@ -0,0 +1,27 @@
+#include <boost/test/unit_test.hpp>
+#include <sio/writer/arena.hh>
+#include <string>
+
+
+BOOST_AUTO_TEST_CASE(arena_writer) {
+    sio::arena arena(64);
+    sio::arena_writer aw(arena);
+    aw << "first " << 1;
+    auto first = aw.finish();
+    auto second = sio::sprintf(arena, "{}-{}", "second", 2);
+
+    std::string long_str(200, 'y');
+    for (int i = 0; i < 5; ++i) {
+        aw << long_str;
+    }
+    auto third = aw.finish();
+
+    BOOST_CHECK(first == sio::string_ref("first 1", 7));
+    BOOST_CHECK_EQUAL(second.str(), "second-2");
+    BOOST_CHECK_EQUAL(third.str(), std::string(1000, 'y'));
+
+    auto capacity = arena.capacity();
+    arena.reset();
+    BOOST_CHECK_EQUAL(sio::sprintf(arena, "{}", 3).str(), "3");
+    BOOST_CHECK_EQUAL(arena.capacity(), capacity);
+}
@@ -0,0 +1,165 @@
+#include <boost/test/unit_test.hpp>
+#include <sio/stream/async.hh>
+
+#ifdef SIO_ASYNC
+
+#include <sio/stream/memory.hh>
+#include <chrono>
+#include <ctime>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+
+namespace {
+
+sio::task<void>
+produce(sio::async_fd_stream &out, std::size_t bytes) {
+    std::string chunk(1000, 'x');
+    for (std::size_t done = 0; done < bytes; done += chunk.size()) {
+        co_await out.async_put(chunk.data(), std::min(chunk.size(), bytes - done));
+    }
+}
+
+
+sio::task<void>
+consume(sio::async_fd_stream &in, std::size_t &total) {
+    char buf[4096];
+    while (auto n = co_await in.async_get(buf, sizeof buf)) {
+        total += n;
+    }
+}
+
+
+sio::task<int>
+answer(sio::event_loop &loop) {
+    co_await loop.yield();
+    co_return 42;
+}
+
+} // namespace
+
+
+BOOST_AUTO_TEST_CASE(async_pipes) {
+    sio::event_loop loop;
+    const std::size_t pipes = 100, bytes = 200000;
+    std::vector<std::unique_ptr<sio::async_fd_stream>> streams;
+    std::vector<std::size_t> totals(pipes);
+    for (std::size_t i = 0; i < pipes; ++i) {
+        int fds[2];
+        BOOST_REQUIRE(::pipe(fds) == 0);
+        streams.emplace_back(new sio::async_fd_stream(loop, fds[0]));
+        streams.emplace_back(new sio::async_fd_stream(loop, fds[1]));
+        loop.spawn(consume(*streams[2 * i], totals[i]));
+        loop.spawn([](sio::async_fd_stream &out, std::size_t bytes) -> sio::task<void> {
+            co_await produce(out, bytes);
+            out.close();
+        }(*streams[2 * i + 1], bytes));
+    }
+    loop.run();
+    for (auto t : totals) BOOST_CHECK_EQUAL(t, bytes);
+
+    int result = 0;
+    sio::memory_stream ms;
+    loop.spawn([](sio::event_loop &loop, sio::memory_stream &ms, int &result) -> sio::task<void> {
+        result = co_await answer(loop);
+        co_await sio::async_put(ms, "abc", 3);
+        co_await sio::async_flush(ms);
+    }(loop, ms, result));
+    loop.run();
+    BOOST_CHECK_EQUAL(result, 42);
+    BOOST_CHECK_EQUAL(ms.tell_put(), 3u);
+
+    loop.spawn([]() -> sio::task<void> {
+        throw std::runtime_error("failed");
+        co_return;
+    }());
+    BOOST_CHECK_THROW(loop.run(), std::runtime_error);
+}
+
+
+BOOST_AUTO_TEST_CASE(async_close_while_waiting) {
+    sio::event_loop loop;
+    int fds[2];
+    BOOST_REQUIRE(::pipe(fds) == 0);
+    sio::async_fd_stream in(loop, fds[0]), out(loop, fds[1]);
+
+    // The reader suspends on an empty pipe, then the other task closes its stream
+    bool failed = false;
+    loop.spawn([](sio::async_fd_stream &in, bool &failed) -> sio::task<void> {
+        char buf[16];
+        try {
+            co_await in.async_get(buf, sizeof buf);
+        } catch (const std::system_error &e) {
+            failed = e.code() == std::errc::bad_file_descriptor;
+        }
+    }(in, failed));
+    loop.spawn([](sio::event_loop &loop, sio::async_fd_stream &in) -> sio::task<void> {
+        co_await loop.yield();
+        in.close();
+    }(loop, in));
+    loop.run();
+    BOOST_CHECK(failed);
+}
+
+
+BOOST_AUTO_TEST_CASE(async_hung_up_idle) {
+    sio::event_loop loop;
+    int idle[2], busy[2];
+    BOOST_REQUIRE(::pipe(idle) == 0 && ::pipe(busy) == 0);
+    sio::async_fd_stream idle_in(loop, idle[0]), idle_out(loop, idle[1]), busy_in(loop, busy[0]);
+
+    // Reads the idle pipe to its end and leaves it open, then waits for a slow writer; the
+    // hung-up descriptor must not keep waking the loop in the meantime
+    std::size_t idle_total = 0, busy_total = 0;
+    loop.spawn(consume(idle_in, idle_total));
+    loop.spawn([](sio::event_loop &loop, sio::async_fd_stream &out) -> sio::task<void> {
+        co_await loop.yield();
+        out.close();
+    }(loop, idle_out));
+    loop.spawn([](sio::event_loop &loop, sio::async_fd_stream &in,
+            std::size_t &total) -> sio::task<void> {
+        co_await loop.yield();
+        co_await loop.yield();
+        co_await consume(in, total);
+    }(loop, busy_in, busy_total));
+
+    std::thread writer([fd = busy[1]] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        BOOST_CHECK_EQUAL(::write(fd, "x", 1), 1);
+        ::close(fd);
+    });
+    auto cpu = std::clock();
+    loop.run();
+    cpu = std::clock() - cpu;
+    writer.join();
+    BOOST_CHECK_EQUAL(idle_total, 0u);
+    BOOST_CHECK_EQUAL(busy_total, 1u);
+    BOOST_CHECK_LT(static_cast<double>(cpu) / CLOCKS_PER_SEC, 0.1);
+}
+
+
+BOOST_AUTO_TEST_CASE(async_second_waiter) {
+    sio::event_loop loop;
+    int fds[2];
+    BOOST_REQUIRE(::pipe(fds) == 0);
+    sio::async_fd_stream in(loop, fds[0]), out(loop, fds[1]);
+
+    // The second reader on the same descriptor fails; a write then releases the first one
+    std::size_t first = 0, second = 0;
+    loop.spawn(consume(in, first));
+    loop.spawn(consume(in, second));
+    loop.spawn([](sio::event_loop &loop, sio::async_fd_stream &out) -> sio::task<void> {
+        co_await loop.yield();
+        co_await out.async_put("abc", 3);
+        out.close();
+    }(loop, out));
+    BOOST_CHECK_THROW(loop.run(), std::logic_error);
+    BOOST_CHECK_EQUAL(first, 3u);
+    BOOST_CHECK_EQUAL(second, 0u);
+}
+
+#endif
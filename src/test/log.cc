@@ -0,0 +1,80 @@
+// Debug calls are compiled out in this file whatever NDEBUG says
+#define SIO_LOG_MIN_LEVEL 2
+
+#include <boost/test/unit_test.hpp>
+#include <sio/writer/log.hh>
+#include <sio/stream/memory.hh>
+#include <string>
+
+
+namespace {
+
+std::string
+contents(sio::memory_stream &ms) {
+    std::string s(static_cast<std::size_t>(ms.tell()), '\0');
+    ms.seek(0);
+    ms.get(&s[0], s.size());
+    ms.seek(0);
+    return s;
+}
+
+// Restores the defaults even when a check throws
+struct log_setup {
+    explicit log_setup(sio::log_sink &sink) {
+        sio::set_log_sink(sink);
+    }
+
+    ~log_setup() {
+        sio::set_log_sink(previous);
+        sio::set_log_level(sio::log_level::info);
+    }
+
+    sio::log_sink &previous = sio::get_log_sink();
+};
+
+}
+
+
+BOOST_AUTO_TEST_CASE(structured_log) {
+    sio::memory_stream ms;
+    sio::text_log_sink text(ms, false);
+    log_setup setup(text);
+
+    int evaluated = 0;
+    auto count = [&] { return ++evaluated; };
+    SIO_INFO("opened", sio::kv("path", "/tmp/x"), sio::kv("fd", count()), sio::kv("ratio", 0.1),
+            sio::kv("ok", true), sio::kv("mode", sio::log_level::warn));
+    BOOST_CHECK_EQUAL(contents(ms),
+            "info opened path=/tmp/x fd=1 ratio=0.1 ok=true mode=sio::log_level::warn\n");
+
+    // Anything that would split into several tokens is quoted
+    SIO_INFO("said hi", sio::kv("who", "a b"), sio::kv("eq", std::string("x=y")),
+            sio::kv("nl", "1\n\"2\"\x01"), sio::kv("empty", ""));
+    BOOST_CHECK_EQUAL(contents(ms),
+            "info \"said hi\" who=\"a b\" eq=\"x=y\" nl=\"1\\n\\\"2\\\"\\x01\" empty=\"\"\n");
+
+    // Below the runtime threshold, and below the compile-time one even when enabled at runtime
+    SIO_LOG(debug, "skipped", sio::kv("n", count()));
+    sio::set_log_level(sio::log_level::trace);
+    SIO_DEBUG("compiled out", sio::kv("n", count()));
+    BOOST_CHECK_EQUAL(evaluated, 1);
+    BOOST_CHECK(sio::log_enabled(sio::log_level::debug));
+    BOOST_CHECK_EQUAL(contents(ms), "");
+
+    sio::text_log_sink stamped(ms);
+    sio::set_log_sink(stamped);
+    SIO_ERROR("failed");
+    auto stamped_line = contents(ms);
+    BOOST_CHECK_EQUAL(stamped_line.size(), 27u + 14u);
+    BOOST_CHECK_EQUAL(stamped_line.substr(26), "Z error failed\n");
+
+    sio::json_log_sink json(ms);
+    sio::set_log_sink(json);
+    SIO_WARN("say \"hi\"\n", sio::kv("n", -3), sio::kv("u", 7u), sio::kv("c", 'x'));
+    auto line = contents(ms);
+    BOOST_CHECK_EQUAL(line.find("{\"time\":"), 0u);
+    auto tail = line.substr(line.find(",\"level\""));
+    BOOST_CHECK_EQUAL(tail.substr(0, tail.find(",\"file\"")),
+            ",\"level\":\"warn\",\"msg\":\"say \\\"hi\\\"\\n\"");
+    BOOST_CHECK_EQUAL(tail.substr(tail.find(",\"n\"")), ",\"n\":-3,\"u\":7,\"c\":\"x\"}\n");
+}
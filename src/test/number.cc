@@ -0,0 +1,119 @@
+#include <boost/test/unit_test.hpp>
+#include <sio/writer/writer.hh>
+#include <sstream>
+#include <locale>
+#include <string>
+#include <vector>
+#include <climits>
+
+
+namespace {
+
+class grouping_numpunct: public std::numpunct<char> {
+protected:
+    virtual char do_decimal_point() const override { return ','; }
+    virtual char do_thousands_sep() const override { return '.'; }
+    virtual std::string do_grouping() const override { return "\3\2"; }
+};
+
+
+class locale_writer final: public sio::writer {
+public:
+    explicit locale_writer(const std::locale &locale)
+        : m_locale(locale) {
+    }
+
+    std::string str;
+
+protected:
+    virtual void v_write(const char *seq, std::size_t n) override {
+        str.append(seq, n);
+    }
+
+    virtual const std::locale &v_locale() const override {
+        return m_locale;
+    }
+
+private:
+    std::locale m_locale;
+};
+
+
+template<typename Number>
+void
+check_against_ostream(const std::locale &locale, Number v, sio::bitfield<sio::fmt> flags,
+        std::ios_base::fmtflags iosflags, unsigned precision = 6) {
+    locale_writer w(locale);
+    sio::write(w, v, flags, precision);
+
+    std::ostringstream oss;
+    oss.imbue(locale);
+    oss.flags(iosflags);
+    oss.precision(precision);
+    oss << v;
+    BOOST_CHECK_EQUAL(w.str, oss.str());
+}
+
+} // namespace
+
+
+BOOST_AUTO_TEST_CASE(number_matches_ostream) {
+    std::locale grouped(std::locale::classic(), new grouping_numpunct);
+    for (auto &locale : { std::locale::classic(), grouped }) {
+        for (long v : { 0L, 7L, -42L, 1234567890L, -98765432L }) {
+            check_against_ostream(locale, v, {}, std::ios_base::dec);
+            check_against_ostream(locale, v, sio::fmt::show_sign,
+                    std::ios_base::dec | std::ios_base::showpos);
+            check_against_ostream(locale, static_cast<unsigned long>(v),
+                    sio::fmt::hex | sio::fmt::show_base | sio::fmt::uppercase,
+                    std::ios_base::hex | std::ios_base::showbase | std::ios_base::uppercase);
+            check_against_ostream(locale, static_cast<unsigned long>(v),
+                    sio::fmt::oct | sio::fmt::show_base,
+                    std::ios_base::oct | std::ios_base::showbase);
+        }
+        for (double v : { 0.0, 1.5, -1234567.25, 1e20, 3.14159265e-7 }) {
+            check_against_ostream(locale, v, {}, {});
+            check_against_ostream(locale, v, sio::fmt::fixed, std::ios_base::fixed, 2);
+            check_against_ostream(locale, v, sio::fmt::sci | sio::fmt::uppercase,
+                    std::ios_base::scientific | std::ios_base::uppercase);
+            check_against_ostream(locale, v, sio::fmt::show_point | sio::fmt::show_sign,
+                    std::ios_base::showpoint | std::ios_base::showpos, 12);
+        }
+        check_against_ostream(locale, 1e300L, sio::fmt::fixed, std::ios_base::fixed);
+        check_against_ostream(locale, -1e4000L, sio::fmt::fixed, std::ios_base::fixed, 40);
+    }
+}
+
+
+BOOST_AUTO_TEST_CASE(array_matches_elements) {
+    std::locale grouped(std::locale::classic(), new grouping_numpunct);
+    std::vector<long> ints { 0, 7, -42, 1234567890, -98765432, LONG_MIN };
+    std::vector<double> floats { 0.0, 1.5, -1234567.25, 1e20, 3.14159265e-7, 1e300 };
+    std::vector<sio::bitfield<sio::fmt>> flag_sets { {}, sio::fmt::show_sign, sio::fmt::hex,
+            sio::fmt::fixed, sio::fmt::sci | sio::fmt::uppercase, sio::fmt::show_point };
+
+    for (auto &locale : { std::locale::classic(), grouped }) {
+        for (auto flags : flag_sets) {
+            locale_writer expected(locale), got(locale);
+            for (std::size_t i = 0; i < ints.size(); ++i) {
+                if (i) expected.str += ", ";
+                sio::write(expected, ints[i], flags, 3);
+            }
+            for (std::size_t i = 0; i < floats.size(); ++i) {
+                expected.str += i ? ", " : "|";
+                sio::write(expected, floats[i], flags, 3);
+            }
+            sio::write_array(got, ints.data(), ints.size(), ", ", flags, 3,
+                    sio::float_repr::precision);
+            got.str += "|";
+            sio::write_array(got, floats.data(), floats.size(), ", ", flags, 3,
+                    sio::float_repr::precision);
+            BOOST_CHECK_EQUAL(got.str, expected.str);
+        }
+    }
+
+    std::vector<double> shortest { 0.1, 1.0 / 3, -2.5, 1e300 };
+    locale_writer w(std::locale::classic());
+    sio::write(w, sio::array(shortest, " ", sio::float_repr::shortest));
+    BOOST_CHECK_EQUAL(w.str, "0.1 0.3333333333333333 -2.5 1e+300");
+}
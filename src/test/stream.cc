@@ -0,0 +1,513 @@
+#include <boost/test/unit_test.hpp>
+#include <sio/stream/memory.hh>
+#include <sio/stream/file.hh>
+#include <sio/stream/binary.hh>
+#include <sio/stream/direct.hh>
+#include <sio/stream/durable.hh>
+#include <sio/stream/fd.hh>
+#include <sio/stream/peek.hh>
+#include <sio/stream/prefetch.hh>
+#include <sio/stream/rotating.hh>
+#include <sio/writer/writer.hh>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <system_error>
+#include <thread>
+#include <vector>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <string>
+
+
+BOOST_AUTO_TEST_CASE(memory_stream) {
+    sio::memory_stream ms;
+    BOOST_CHECK_EQUAL(ms.put("hello world", 11), 11u);
+    BOOST_CHECK_EQUAL(ms.tell(), 11u);
+
+    char buf[16];
+    ms.seek_get(6);
+    BOOST_CHECK_EQUAL(ms.get(buf, sizeof buf), 5u);
+    BOOST_CHECK_EQUAL(std::string(buf, 5), "world");
+    BOOST_CHECK_EQUAL(ms.get(buf, sizeof buf), 0u);
+
+    ms.seek_put(-5, sio::seek::end);
+    ms.put("there", 5);
+    ms.seek_get(0);
+    BOOST_CHECK_EQUAL(ms.get(buf, sizeof buf), 11u);
+    BOOST_CHECK_EQUAL(std::string(buf, 11), "hello there");
+}
+
+
+BOOST_AUTO_TEST_CASE(memory_stream_seek) {
+    sio::memory_stream ms;
+    ms.put("0123456789", 10);
+    char buf[4];
+
+    // Offsets from the end count forward like lseek, so -3 is three bytes before it
+    BOOST_CHECK_EQUAL(ms.seek(-3, sio::seek::end), 7u);
+    BOOST_CHECK_EQUAL(ms.get(buf, sizeof buf), 3u);
+    BOOST_CHECK_EQUAL(std::string(buf, 3), "789");
+    BOOST_CHECK_EQUAL(ms.tell(), 10u);
+
+    BOOST_CHECK_EQUAL(ms.seek(-4, sio::seek::cur), 6u);
+    BOOST_CHECK_EQUAL(ms.seek(-100, sio::seek::cur), 0u);
+    BOOST_CHECK_EQUAL(ms.get(buf, 2), 2u);
+    BOOST_CHECK_EQUAL(std::string(buf, 2), "01");
+
+    // Putting past the end fills the gap with zeros
+    BOOST_CHECK_EQUAL(ms.seek(2, sio::seek::end), 12u);
+    BOOST_CHECK_EQUAL(ms.put("x", 1), 1u);
+    BOOST_CHECK_EQUAL(ms.seek(-4, sio::seek::end), 9u);
+    BOOST_CHECK_EQUAL(ms.get(buf, sizeof buf), 4u);
+    BOOST_CHECK_EQUAL(std::string(buf, 4), std::string("9\0\0x", 4));
+}
+
+
+BOOST_AUTO_TEST_CASE(file_read_stream_keeps_contents) {
+    const char *path = "sio-test-read.dat";
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << "kept";
+    }
+    {
+        // Read-only streams default to open_mode::truncate, which must not reach the file
+        sio::file_read_stream in(path);
+        char buf[8];
+        BOOST_CHECK_EQUAL(in.get(buf, sizeof buf), 4u);
+        BOOST_CHECK_EQUAL(std::string(buf, 4), "kept");
+    }
+    std::remove(path);
+}
+
+
+BOOST_AUTO_TEST_CASE(static_dispatch) {
+    static_assert(sio::has_inline_put<sio::memory_stream>{}, "");
+    static_assert(sio::has_inline_put<sio::file_rw_stream>{}, "");
+    static_assert(!sio::has_inline_put<sio::out_stream>{}, "");
+    static_assert(sio::has_inline_get<sio::file_read_stream>{}, "");
+
+    sio::memory_stream ms;
+    {
+        sio::stream_writer<sio::memory_stream> w(ms);
+        w << "a=" << 1 << sio::nl;
+        sio::out_stream &erased = ms;
+        sio::stream_writer<sio::out_stream> ew(erased);
+        ew << "b=" << 2 << sio::nl;
+    }
+    sio::static_flush(ms);
+    ms.seek(0);
+    char buf[16];
+    auto n = sio::static_get(ms, buf, sizeof buf);
+    BOOST_CHECK_EQUAL(std::string(buf, n), "a=1\nb=2\n");
+}
+
+
+BOOST_AUTO_TEST_CASE(stream_stats) {
+    sio::latency_histogram h;
+    for (std::uint64_t ns : { 0, 1, 3, 100, 100, 5000 }) {
+        h.record(ns);
+    }
+    BOOST_CHECK_EQUAL(h.count(), 6u);
+    BOOST_CHECK_EQUAL(h.max_ns(), 5000u);
+    BOOST_CHECK_EQUAL(h.percentile_ns(.5), 3u);
+    BOOST_CHECK_EQUAL(h.percentile_ns(.8), 127u);
+    BOOST_CHECK_EQUAL(h.percentile_ns(1), 5000u);
+
+    sio::memory_stream ms;
+    ms.put("abc", 3);
+    ms.seek_get(0);
+    char buf[4];
+    ms.get(buf, 4);
+#ifdef SIO_STATS
+    BOOST_REQUIRE(ms.stats());
+    BOOST_CHECK_EQUAL(ms.stats()->bytes_out, 3u);
+    BOOST_CHECK_EQUAL(ms.stats()->bytes_in, 3u);
+    BOOST_CHECK_EQUAL(ms.stats()->seeks, 1u);
+    BOOST_CHECK_EQUAL(ms.stats()->get_latency.count(), 1u);
+    ms.reset_stats();
+    BOOST_CHECK_EQUAL(ms.stats()->puts, 0u);
+#else
+    BOOST_CHECK(!ms.stats());
+#endif
+}
+
+
+namespace {
+
+std::string
+slurp(const char *path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+}
+
+
+BOOST_AUTO_TEST_CASE(direct_out_stream) {
+    const char *path = "sio-test-direct.dat";
+    std::string expected;
+    for (std::size_t i = 0; i < 10000; ++i) {
+        expected.push_back(static_cast<char>('a' + i % 26));
+    }
+
+    for (bool direct : { true, false }) {
+        sio::direct_options opts;
+        opts.direct = direct;
+        opts.buffer_size = 4096;
+        opts.writeback_window = direct ? 0 : 2048;
+        {
+            sio::direct_out_stream s(path, sio::open_mode::truncate, opts);
+            s.put(expected.data(), 5000);
+            s.flush();
+            BOOST_CHECK_EQUAL(slurp(path), expected.substr(0, 5000));
+            s.put(expected.data() + 5000, 5000);
+            BOOST_CHECK_EQUAL(s.size(), 10000u);
+        }
+        BOOST_CHECK_EQUAL(slurp(path), expected);
+
+        {
+            sio::direct_out_stream s(path, sio::open_mode::append, opts);
+            s.put("tail", 4);
+        }
+        BOOST_CHECK_EQUAL(slurp(path), expected + "tail");
+
+        {
+            sio::direct_out_stream s(path, sio::open_mode::overwrite, opts);
+            s.put("HEAD", 4);
+        }
+        BOOST_CHECK_EQUAL(slurp(path), "HEAD" + expected.substr(4) + "tail");
+    }
+    std::remove(path);
+}
+
+
+BOOST_AUTO_TEST_CASE(rotating_file_out_stream) {
+    char dir[] = "sio-test-rotating-XXXXXX";
+    BOOST_REQUIRE(mkdtemp(dir));
+    std::string path = std::string(dir) + "/log";
+
+    std::vector<std::string> archived;
+    sio::rotating_options opts;
+    opts.max_bytes = 10;
+    opts.archive = [&](const std::string &p) { archived.push_back(p); };
+    {
+        sio::rotating_file_out_stream s(path, opts);
+        for (char c : std::string("abcde")) {
+            s.put(std::string(6, c).data(), 6);
+        }
+        BOOST_CHECK_EQUAL(s.segment(), 5u);
+        s.wait_idle();
+        BOOST_CHECK_EQUAL(archived.size(), 4u);
+        BOOST_CHECK_EQUAL(archived.back(), path + ".4");
+    }
+    BOOST_CHECK_EQUAL(slurp((path + ".1").c_str()), "aaaaaa");
+    BOOST_CHECK_EQUAL(slurp((path + ".4").c_str()), "dddddd");
+
+    {
+        sio::rotating_file_out_stream s(path, opts);
+        BOOST_CHECK_EQUAL(s.segment(), 5u);
+        BOOST_CHECK_EQUAL(s.size(), 6u);
+        s.put("ff", 2);
+        s.put("ggg", 3);
+    }
+    BOOST_CHECK_EQUAL(slurp((path + ".5").c_str()), "eeeeeeff");
+    BOOST_CHECK_EQUAL(slurp(path.c_str()), "ggg");
+
+    for (int i = 1; i <= 5; ++i) {
+        std::remove((path + "." + std::to_string(i)).c_str());
+    }
+    std::remove(path.c_str());
+    std::remove(dir);
+}
+
+
+BOOST_AUTO_TEST_CASE(durable_out_stream) {
+    const char *path = "sio-test-durable.dat";
+    const std::size_t threads = 8, commits = 25;
+    {
+        sio::durable_out_stream s(path, sio::open_mode::truncate);
+        std::atomic<std::size_t> ready { 0 };
+        std::vector<std::thread> workers;
+        for (std::size_t t = 0; t < threads; ++t) {
+            workers.emplace_back([&s, &ready, t] {
+                char record[] = { static_cast<char>('a' + t), '\n' };
+                // Start together and only wait at the end, so that commits pile up behind the
+                // running sync and have to share the next one
+                ++ready;
+                while (ready < threads) std::this_thread::yield();
+                std::vector<std::future<void>> done;
+                for (std::size_t i = 0; i < commits; ++i) {
+                    s.put(record, sizeof record);
+                    done.push_back(s.commit());
+                }
+                for (auto &d : done) d.get();
+            });
+        }
+        for (auto &w : workers) w.join();
+        BOOST_CHECK_GT(s.syncs(), 0u);
+        BOOST_CHECK_LT(s.syncs(), threads * commits);
+        BOOST_CHECK_EQUAL(slurp(path).size(), threads * commits * 2);
+
+        auto before = s.syncs();
+        s.sync();
+        BOOST_CHECK_EQUAL(s.syncs(), before);
+    }
+    std::remove(path);
+}
+
+
+BOOST_AUTO_TEST_CASE(prefetch_read_stream) {
+    const char *path = "sio-test-prefetch.dat";
+    std::string data;
+    for (std::size_t i = 0; i < 100000; ++i) {
+        data.push_back(static_cast<char>(i * 7 % 251));
+    }
+    std::ofstream(path, std::ios::binary) << data;
+
+    sio::memory_stream ms;
+    ms.put(data.data(), data.size());
+    ms.seek_get(0);
+    sio::prefetch_read_stream from_stream(ms, 4096);
+    sio::prefetch_read_stream from_file(path, 4096);
+
+    for (sio::read_stream *s : { static_cast<sio::read_stream*>(&from_stream),
+            static_cast<sio::read_stream*>(&from_file) }) {
+        std::string got(data.size() + 10, 0);
+        std::size_t n = 0;
+        for (std::size_t chunk = 1; n < data.size(); chunk = chunk * 3 % 10007 + 1) {
+            auto r = s->get(&got[n], chunk);
+            if (r == 0) break;
+            n += r;
+        }
+        BOOST_CHECK_EQUAL(n, data.size());
+        BOOST_CHECK(got.substr(0, n) == data);
+
+        char buf[100];
+        for (sio::stream_pos pos : { 50000, 50010, 4000, 99950, 12345 }) {
+            BOOST_CHECK_EQUAL(s->seek_get(pos), pos);
+            auto r = s->get(buf, sizeof buf);
+            BOOST_CHECK_EQUAL(r, std::min<std::size_t>(100, data.size() - pos));
+            BOOST_CHECK(std::string(buf, r) == data.substr(pos, r));
+            BOOST_CHECK_EQUAL(s->tell_get(), pos + r);
+        }
+        BOOST_CHECK_EQUAL(s->seek_get(-10, sio::seek::end), data.size() - 10);
+        BOOST_CHECK_EQUAL(s->get(buf, sizeof buf), 10u);
+        BOOST_CHECK_EQUAL(s->seek_get(-20, sio::seek::cur), data.size() - 20);
+        BOOST_CHECK_EQUAL(s->get(buf, sizeof buf), 20u);
+    }
+    std::remove(path);
+}
+
+
+BOOST_AUTO_TEST_CASE(binary_encoding) {
+    BOOST_CHECK_EQUAL(sio::zigzag_encode(0), 0u);
+    BOOST_CHECK_EQUAL(sio::zigzag_encode(-1), 1u);
+    BOOST_CHECK_EQUAL(sio::zigzag_encode(1), 2u);
+    BOOST_CHECK_EQUAL(sio::zigzag_decode(sio::zigzag_encode(INT64_MIN)), INT64_MIN);
+
+    sio::memory_stream ms;
+    const double doubles[] = { 1.5, -0.25, 1e300 };
+    {
+        sio::binary_writer w(ms, 16);
+        w.put_le<std::uint32_t>(0x01020304);
+        w.put_be<std::uint32_t>(0x01020304);
+        w.put_be(-2.5f);
+        w.put_varint(300);
+        w.put_varint(UINT64_MAX);
+        w.put_svarint(-3);
+        w.put_array(doubles, 3);
+        w.put_le<std::int16_t>(-2);
+        BOOST_CHECK_EQUAL(w.position(), 4 + 4 + 4 + 2 + 10 + 1 + 24 + 2u);
+    }
+
+    unsigned char head[8];
+    ms.seek_get(0);
+    ms.get(head, sizeof head);
+    const unsigned char expected_head[] = { 4, 3, 2, 1, 1, 2, 3, 4 };
+    BOOST_CHECK_EQUAL_COLLECTIONS(head, head + 8, expected_head, expected_head + 8);
+
+    ms.seek_get(0);
+    sio::binary_reader r(ms, 16);
+    BOOST_CHECK_EQUAL(r.get_le<std::uint32_t>(), 0x01020304u);
+    BOOST_CHECK_EQUAL(r.get_be<std::uint32_t>(), 0x01020304u);
+    BOOST_CHECK_EQUAL(r.get_be<float>(), -2.5f);
+    BOOST_CHECK_EQUAL(r.get_varint(), 300u);
+    BOOST_CHECK_EQUAL(r.get_varint(), UINT64_MAX);
+    BOOST_CHECK_EQUAL(r.get_svarint(), -3);
+    double got[3];
+    r.get_array(got, 3);
+    BOOST_CHECK_EQUAL_COLLECTIONS(got, got + 3, doubles, doubles + 3);
+    BOOST_CHECK_EQUAL(r.get_le<std::int16_t>(), -2);
+    BOOST_CHECK(r.at_end());
+    BOOST_CHECK_THROW(r.get_le<std::uint32_t>(), sio::decode_error);
+
+    // A tenth byte above 1 sets bits past 64, through both the buffered and the slow path
+    std::string overlong(1, '\0');
+    overlong += std::string(9, '\xff') + '\x02' + std::string(16, '\0');
+    for (std::size_t buffer_size : { 64, 4 }) {
+        sio::memory_stream bad;
+        bad.put(overlong.data(), overlong.size());
+        bad.seek_get(0);
+        sio::binary_reader br(bad, buffer_size);
+        BOOST_CHECK_EQUAL(br.get_le<std::uint8_t>(), 0u);
+        BOOST_CHECK_THROW(br.get_varint(), sio::decode_error);
+    }
+}
+
+
+// Takes at most three bytes per put, and nothing once its limit is reached
+class trickle_stream final: public sio::out_stream {
+public:
+    explicit trickle_stream(std::size_t limit): m_limit(limit) {}
+
+    std::string data;
+
+protected:
+    virtual std::size_t v_put(const void *in, std::size_t bytes) override {
+        auto n = std::min<std::size_t>({ bytes, 3, m_limit - data.size() });
+        data.append(static_cast<const char*>(in), n);
+        return n;
+    }
+
+private:
+    std::size_t m_limit;
+};
+
+
+BOOST_AUTO_TEST_CASE(binary_writer_short_puts) {
+    const std::string payload = "0123456789abcdefghij";
+    trickle_stream slow(1000);
+    {
+        sio::binary_writer w(slow, 16);
+        w.put_bytes("xy", 2);
+        w.put_bytes(payload.data(), payload.size());
+        w.put_le<std::uint32_t>(0x64636261);
+    }
+    BOOST_CHECK_EQUAL(slow.data, "xy" + payload + "abcd");
+
+    trickle_stream full(5);
+    sio::binary_writer w(full, 16);
+    w.put_bytes(payload.data(), 8);
+    BOOST_CHECK_THROW(w.flush(), std::system_error);
+    BOOST_CHECK_EQUAL(full.data, "01234");
+    BOOST_CHECK_EQUAL(w.position(), 8u);
+}
+
+
+BOOST_AUTO_TEST_CASE(fd_stream_nonblocking) {
+    auto pipe = sio::make_pipe();
+    char c;
+    BOOST_CHECK_EQUAL(pipe->in.get(&c, 1), 0u);
+    BOOST_CHECK(pipe->in.status() == sio::io_status::would_block);
+
+    // Fill the pipe so that the remainder has to be kept
+    std::vector<char> data(1 << 20);
+    for (std::size_t i = 0; i < data.size(); ++i) data[i] = static_cast<char>(i * 7);
+    auto put = pipe->out.try_put(data.data(), data.size());
+    BOOST_CHECK_EQUAL(put.bytes, data.size());
+    BOOST_CHECK(pipe->out.wants_write());
+
+    std::vector<char> got;
+    char buf[8192];
+    while (got.size() < data.size()) {
+        auto r = pipe->in.try_get(buf, sizeof buf);
+        got.insert(got.end(), buf, buf + r.bytes);
+        if (r.status == sio::io_status::would_block) pipe->out.flush();
+    }
+    BOOST_CHECK(got == data);
+    BOOST_CHECK(!pipe->out.wants_write());
+
+    pipe->out.close();
+    BOOST_CHECK(pipe->in.wait_readable(0));
+    BOOST_CHECK(pipe->in.try_get(buf, sizeof buf).status == sio::io_status::eof);
+
+    int fds[2];
+    BOOST_REQUIRE_EQUAL(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    sio::fd_duplex_stream a(fds[0]), b(fds[1]);
+    BOOST_CHECK_EQUAL(a.put("ping", 4), 4u);
+    BOOST_CHECK(b.wait_readable(1000));
+    BOOST_CHECK_EQUAL(b.get(buf, sizeof buf), 4u);
+    b.close();
+    BOOST_CHECK(a.try_put("x", 1).status == sio::io_status::eof);
+}
+
+
+namespace {
+
+// Peeks across buffer boundaries while reading with a mix of consume and get
+void
+check_peek_walk(sio::peek_stream &s, const std::string &data) {
+    std::size_t pos = 0;
+    char buf[64];
+    while (pos < data.size()) {
+        auto view = s.peek(100);
+        auto expected = std::min<std::size_t>(100, data.size() - pos);
+        BOOST_REQUIRE_GE(view.size(), expected);
+        BOOST_REQUIRE(view.substr(0, expected) == sio::string_ref(data).substr(pos, expected));
+        if (pos % 2) {
+            s.consume(std::min<std::size_t>(77, view.size()));
+            pos += std::min<std::size_t>(77, view.size());
+        } else {
+            auto n = s.get(buf, sizeof buf);
+            BOOST_REQUIRE(sio::string_ref(buf, n) == sio::string_ref(data).substr(pos, n));
+            pos += n;
+        }
+    }
+    BOOST_CHECK(s.peek(1).empty());
+}
+
+}
+
+
+BOOST_AUTO_TEST_CASE(peek_consume) {
+    std::string data;
+    for (int i = 0; data.size() < 20000; ++i) data += std::to_string(i * 31) + ",";
+
+    sio::memory_stream ms;
+    ms.put(data.data(), data.size());
+    ms.seek(0);
+    auto view = ms.peek(4);
+    BOOST_CHECK(view == data);
+    BOOST_CHECK(ms.peek(4).data() == view.data());
+    check_peek_walk(ms, data);
+
+    char path[] = "/tmp/sio_peek_XXXXXX";
+    int fd = ::mkstemp(path);
+    BOOST_REQUIRE(fd >= 0);
+    BOOST_REQUIRE_EQUAL(::write(fd, data.data(), data.size()), static_cast<ssize_t>(data.size()));
+    ::close(fd);
+    {
+        sio::file_read_stream fs(path);
+        check_peek_walk(fs, data);
+    }
+    std::remove(path);
+
+    // A pipe cannot seek back, so spanning peeks stay in the side buffer
+    int fds[2];
+    BOOST_REQUIRE_EQUAL(::pipe(fds), 0);
+    BOOST_REQUIRE_EQUAL(::write(fds[1], data.data(), data.size()),
+            static_cast<ssize_t>(data.size()));
+    ::close(fds[1]);
+    {
+        sio::file_in_stream ps("/dev/fd/" + std::to_string(fds[0]));
+        check_peek_walk(ps, data);
+    }
+    ::close(fds[0]);
+
+    ms.seek(0);
+    sio::in_stream &erased = ms;
+    sio::peek_in_stream adapter(erased, 256);
+    check_peek_walk(adapter, data);
+
+    ms.seek(0);
+    char head[8];
+    BOOST_CHECK(sio::read_exact(ms, head, sizeof head));
+    BOOST_CHECK(std::string(head, 8) == data.substr(0, 8));
+    ms.seek(static_cast<sio::stream_off>(data.size()) - 3, sio::seek::set);
+    BOOST_CHECK_THROW(sio::read_exact(ms, head, sizeof head), sio::short_read);
+    BOOST_CHECK(!sio::read_exact(ms, head, sizeof head));
+}
@@ -0,0 +1,33 @@
+#include <boost/test/unit_test.hpp>
+#include <sio/writer/table.hh>
+#include <string>
+
+
+BOOST_AUTO_TEST_CASE(table_writer_csv) {
+    std::string str;
+    {
+        sio::ref_string_writer sw(str);
+        sio::table_writer table(sw, {
+            { }, { sio::fmt::hex | sio::fmt::show_base }, { {}, 2, 0, sio::quoting::all }
+        });
+        table.row("plain", 255, "x");
+        table.row("a,b", 16, "say \"hi\"");
+        table.row("line\nbreak");
+    }
+    BOOST_CHECK_EQUAL(str, "plain,0xff,\"x\"\n\"a,b\",0x10,\"say \"\"hi\"\"\"\n\"line\nbreak\"\n");
+}
+
+
+BOOST_AUTO_TEST_CASE(table_writer_tsv_width) {
+    std::string str;
+    {
+        sio::ref_string_writer sw(str);
+        sio::table_writer table(sw, {
+            { sio::fmt::left, 6, 5, sio::quoting::none },
+            { {}, 6, 4, sio::quoting::none },
+            { sio::fmt::center, 6, 5, sio::quoting::none }
+        }, '\t');
+        table.row("ab", 7, "c");
+    }
+    BOOST_CHECK_EQUAL(str, "ab   \t   7\t  c  \n");
+}
@@ -0,0 +1,58 @@
+#include <boost/test/unit_test.hpp>
+#include <sio/writer/time.hh>
+#include <string>
+
+using namespace std::chrono;
+using namespace sio::ops;
+
+
+namespace {
+
+// 2026-10-19T12:34:56Z, a Monday
+const system_clock::time_point base = system_clock::time_point(seconds(1792413296));
+
+template<typename Formatter>
+std::string
+str(const Formatter &f) {
+    return std::string {} << f << sio::ret;
+}
+
+}
+
+
+BOOST_AUTO_TEST_CASE(timestamp_format) {
+    auto t = base + nanoseconds(123456789);
+    BOOST_CHECK_EQUAL(str(sio::timestamp(t)), "2026-10-19T12:34:56.123456Z");
+    BOOST_CHECK_EQUAL(str(sio::timestamp(t, 0)), "2026-10-19T12:34:56Z");
+    BOOST_CHECK_EQUAL(str(sio::timestamp(t, 9)), "2026-10-19T12:34:56.123456789Z");
+    BOOST_CHECK_EQUAL(str(sio::timestamp(time_point_cast<milliseconds>(t), 3)),
+            "2026-10-19T12:34:56.123Z");
+
+    // The cached second must be replaced when the second changes, in both directions
+    sio::time_formatter layout("%a %d %b %Y %H:%M:%S.%3f %z %% [%1f] %q");
+    BOOST_CHECK_EQUAL(str(sio::timestamp(t, layout)),
+            "Mon 19 Oct 2026 12:34:56.123 +0000 % [1] %q");
+    BOOST_CHECK_EQUAL(str(sio::timestamp(t + seconds(4), layout)),
+            "Mon 19 Oct 2026 12:35:00.123 +0000 % [1] %q");
+    BOOST_CHECK_EQUAL(str(sio::timestamp(t, layout)),
+            "Mon 19 Oct 2026 12:34:56.123 +0000 % [1] %q");
+
+    BOOST_CHECK_EQUAL(str(sio::timestamp(system_clock::time_point(nanoseconds(-1)), 9)),
+            "1969-12-31T23:59:59.999999999Z");
+}
+
+
+BOOST_AUTO_TEST_CASE(duration_format) {
+    BOOST_CHECK_EQUAL(str(sio::duration(nanoseconds(0))), "0ns");
+    BOOST_CHECK_EQUAL(str(sio::duration(nanoseconds(999))), "999ns");
+    BOOST_CHECK_EQUAL(str(sio::duration(microseconds(1500))), "1.5ms");
+    BOOST_CHECK_EQUAL(str(sio::duration(nanoseconds(20001))), "20.001us");
+    BOOST_CHECK_EQUAL(str(sio::duration(nanoseconds(1234567891), 2)), "1.23s");
+    BOOST_CHECK_EQUAL(str(sio::duration(-minutes(2))), "-120s");
+    BOOST_CHECK_EQUAL(str(sio::duration(duration<double>(0.25))), "250ms");
+
+    BOOST_CHECK_EQUAL(str(sio::iso8601_duration(seconds(0))), "PT0S");
+    BOOST_CHECK_EQUAL(str(sio::iso8601_duration(hours(1) + minutes(2) + milliseconds(3500))),
+            "PT1H2M3.5S");
+    BOOST_CHECK_EQUAL(str(sio::iso8601_duration(-minutes(90))), "-PT1H30M");
+}
@@ -1,5 +1,10 @@
 #include <boost/test/unit_test.hpp>
 #include <sio/writer/writer.hh>
+#include <sio/writer/compat.hh>
+#include <sio/writer/parallel.hh>
+#include <sio/stream/memory.hh>
+#include <numeric>
+#include <stdexcept>
 #include <string>
 
 using namespace sio::ops;
@@ -7,4 +12,167 @@ using namespace sio::ops;
 
 BOOST_AUTO_TEST_CASE(string_writer) {
     BOOST_CHECK_EQUAL(std::string {} << "Hello " << "World!" << sio::ret, "Hello World!");
+
+    std::string str;
+    sio::ref_string_writer sw(str, 64);
+    BOOST_CHECK_GE(str.capacity(), 64u);
+    std::string big(1000, 'x');
+    for (int i = 0; i < 10; ++i) {
+        sw << big << i;
+    }
+    BOOST_CHECK_EQUAL(str.size(), 10010u);
+    BOOST_CHECK_EQUAL(&sw.str(), &str);
+}
+
+
+BOOST_AUTO_TEST_CASE(enum_write) {
+    BOOST_CHECK_EQUAL(std::string {} << sio::line_ending::crlf << sio::ret,
+            "sio::line_ending::crlf");
+    BOOST_CHECK_EQUAL(std::string {} << sio::fmt::hex << sio::ret, "sio::fmt::hex");
+    BOOST_CHECK_EQUAL(std::string {} << static_cast<sio::line_ending>(7) << sio::ret,
+            "sio::line_ending::<7>");
+}
+
+
+BOOST_AUTO_TEST_CASE(enum_parse) {
+    sio::fmt f {};
+    BOOST_CHECK(sio::parse_enum("show_sign", f));
+    BOOST_CHECK(f == sio::fmt::show_sign);
+    BOOST_CHECK(sio::parse_enum("sio::fmt::center", f));
+    BOOST_CHECK(f == sio::fmt::center);
+    BOOST_CHECK(!sio::parse_enum("centre", f));
+    BOOST_CHECK_EQUAL(sio::enum_name(sio::line_ending::lf), std::string("lf"));
+}
+
+
+BOOST_AUTO_TEST_CASE(bitfield_write) {
+    auto flags = sio::fmt::oct | sio::fmt::fixed | static_cast<sio::fmt>(2048);
+    BOOST_CHECK_EQUAL(std::string {} << flags << sio::ret,
+            "sio::fmt::<2048> | sio::fmt::fixed | sio::fmt::oct");
+    BOOST_CHECK_EQUAL(std::string {} << sio::compact(flags) << sio::ret,
+            "sio::fmt::(<2048> | fixed | oct)");
+    BOOST_CHECK_EQUAL(std::string {} << sio::compact(sio::bitfield<sio::fmt>(sio::fmt::hex))
+            << sio::ret, "sio::fmt::hex");
+    BOOST_CHECK_EQUAL(std::string {} << sio::bitfield<sio::fmt>() << sio::ret, "");
+}
+
+
+namespace {
+
+struct legacy {
+    int value;
+};
+
+std::ostream &operator<<(std::ostream &os, const legacy &l) {
+    return os << std::hex << "legacy(" << l.value << ")";
+}
+
+struct nested {};
+
+std::ostream &operator<<(std::ostream &os, nested) {
+    sio::string_writer sw;
+    sw << legacy{10};
+    return os << "nested " << sw.str() << " " << std::string(200, 'x');
+}
+
+class failing_writer final: public sio::writer {
+protected:
+    virtual void v_write(const char *, std::size_t) override {
+        throw std::runtime_error("write failed");
+    }
+};
+
+} // namespace
+
+
+BOOST_AUTO_TEST_CASE(compat_ostream) {
+    BOOST_CHECK_EQUAL(std::string {} << legacy{255} << " " << legacy{16} << sio::ret,
+            "legacy(ff) legacy(10)");
+    BOOST_CHECK_EQUAL(std::string {} << nested{} << sio::ret,
+            "nested legacy(a) " + std::string(200, 'x'));
+
+    failing_writer fw;
+    BOOST_CHECK_THROW(fw << legacy{1}, std::runtime_error);
+    BOOST_CHECK_THROW(fw << nested{}, std::runtime_error);
+    BOOST_CHECK_EQUAL(std::string {} << legacy{2} << sio::ret, "legacy(2)");
+}
+
+
+BOOST_AUTO_TEST_CASE(formatted_size) {
+    BOOST_CHECK_EQUAL(sio::formatted_size("{} + {x} = {}", 12, 255, std::string("abc")),
+            std::string("12 + ff = abc").size());
+
+    BOOST_CHECK_EQUAL(sio::sprintf("{1}-{0}-{}", "a", 42), "42-a-42");
+
+    std::string long_arg(100, 'x');
+    auto str = sio::sprintf("{}: {}", long_arg, 3.5);
+    BOOST_CHECK_EQUAL(str, long_arg + ": 3.5");
+    BOOST_CHECK_EQUAL(sio::sprintf_exact("{}: {}", long_arg, 3.5), str);
+}
+
+
+BOOST_AUTO_TEST_CASE(fixed_writer) {
+    sio::fixed_writer<16> fw;
+    fw << "n = " << 42 << sio::nl;
+    BOOST_CHECK_EQUAL(std::string(fw.data(), fw.size()), "n = 42\n");
+    BOOST_CHECK(!fw.truncated());
+
+    fw.clear();
+    fw << sio::format("{} and {x} overflow", 123456789, 255);
+    BOOST_CHECK_EQUAL(fw.size(), 16u);
+    BOOST_CHECK_EQUAL(fw.required(), 25u);
+    BOOST_CHECK(fw.truncated());
+    BOOST_CHECK_EQUAL(std::string(fw.data(), fw.size()), "123456789 and ff");
+
+    char buf[4];
+    BOOST_CHECK_EQUAL(sio::format_to(buf, sizeof buf, "{}", 1.25), 4u);
+    BOOST_CHECK_EQUAL(std::string(buf), "1.2");
+    char full[8];
+    BOOST_CHECK_EQUAL(sio::format_to(full, sizeof full, "{}", 1.25), 4u);
+    BOOST_CHECK_EQUAL(std::string(full), "1.25");
+    BOOST_CHECK_EQUAL(sio::format_to(nullptr, 0, "{}", 1.25), 4u);
+    sio::span_writer empty(nullptr, 0);
+    empty << "abc";
+    BOOST_CHECK_EQUAL(empty.size(), 0u);
+    BOOST_CHECK_EQUAL(empty.required(), 3u);
+
+    sio::fixed_writer<1024> big;
+    big << sio::num(1e300, sio::fmt::fixed, 2);
+    BOOST_CHECK(!big.truncated());
+    BOOST_CHECK_EQUAL(big.size(), 304u);
+    big.clear();
+    big << sio::num(0.5, sio::fmt::fixed, 1000);
+    BOOST_CHECK_EQUAL(big.size(), 1002u);
+}
+
+
+BOOST_AUTO_TEST_CASE(format_parallel) {
+    std::vector<int> records(100000);
+    std::iota(records.begin(), records.end(), 0);
+    auto format = [](sio::writer &w, int r) {
+        w << r << ";" << sio::num(r, sio::fmt::hex) << sio::nl;
+    };
+
+    std::string expected;
+    sio::ref_string_writer sw(expected);
+    for (int r : records) format(sw, r);
+
+    sio::task_pool pool(4);
+    sio::parallel_options opts;
+    opts.chunk_records = 1000;
+    opts.max_pending = 3;
+    sio::memory_stream ms;
+    sio::format_parallel(ms, pool, records.begin(), records.end(), format, opts);
+
+    std::string got(expected.size() + 1, 0);
+    ms.seek_get(0);
+    BOOST_CHECK_EQUAL(ms.get(&got[0], got.size()), expected.size());
+    got.resize(expected.size());
+    BOOST_CHECK(got == expected);
+
+    auto failing = [](sio::writer &, int r) {
+        if (r == 54321) throw std::runtime_error("bad record");
+    };
+    BOOST_CHECK_THROW(sio::format_parallel(ms, pool, records, failing, opts),
+            std::runtime_error);
 }